@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui network xml
+QT       += core gui network xml concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -20,7 +20,37 @@ SOURCES += main.cpp\
     groupdata.cpp \
     addgroupdialog.cpp \
     preferencesdialog.cpp \
-    splashdialog.cpp
+    splashdialog.cpp \
+    sessionmanager.cpp \
+    commandtree.cpp \
+    helptreecache.cpp \
+    commandhistory.cpp \
+    helpindex.cpp \
+    connectionmodel.cpp \
+    connectionstore.cpp \
+    memberlistloader.cpp \
+    membercache.cpp \
+    startuptimeline.cpp \
+    connectionindex.cpp \
+    connectionfilter.cpp \
+    healthprober.cpp \
+    panetheme.cpp \
+    panepool.cpp \
+    linebuffer.cpp \
+    consoletile.cpp \
+    dashboardview.cpp \
+    mergedlogview.cpp \
+    alertmatcher.cpp \
+    alertengine.cpp \
+    watchview.cpp \
+    timeseries.cpp \
+    metricextractor.cpp \
+    jobdata.cpp \
+    timerwheel.cpp \
+    jobscheduler.cpp \
+    jobsdialog.cpp \
+    memorybudget.cpp \
+    memoryview.cpp
 
 HEADERS  += mainwindow.h \
     connectionpane.h \
@@ -29,14 +59,45 @@ HEADERS  += mainwindow.h \
     groupdata.h \
     addgroupdialog.h \
     preferencesdialog.h \
-    splashdialog.h
+    splashdialog.h \
+    sessionmanager.h \
+    commandtree.h \
+    helptreecache.h \
+    commandhistory.h \
+    helpindex.h \
+    connectionmodel.h \
+    connectionstore.h \
+    memberlistloader.h \
+    membercache.h \
+    startuptimeline.h \
+    connectionindex.h \
+    connectionfilter.h \
+    healthprober.h \
+    panetheme.h \
+    panepool.h \
+    linebuffer.h \
+    consoletile.h \
+    dashboardview.h \
+    mergedlogview.h \
+    alertmatcher.h \
+    alertengine.h \
+    watchview.h \
+    timeseries.h \
+    metricextractor.h \
+    jobdata.h \
+    timerwheel.h \
+    jobscheduler.h \
+    jobsdialog.h \
+    memorybudget.h \
+    memoryview.h
 
 FORMS    += mainwindow.ui \
     connectionpane.ui \
     addconndialog.ui \
     addgroupdialog.ui \
     preferencesdialog.ui \
-    splashdialog.ui
+    splashdialog.ui \
+    jobsdialog.ui
 
 RESOURCES += \
     Resources.qrc
@@ -13,6 +13,7 @@ AddGroupDialog::AddGroupDialog(QWidget *parent) :
     Source = ui->source;
     User = ui->user;
     Pass = ui->pass;
+    Refresh = ui->refresh;
 
     connect(ui->buttonBox, SIGNAL(accepted()), this, SLOT(OnOK()));
     connect(ui->buttonBox, SIGNAL(rejected()), this, SLOT(OnCancel()));
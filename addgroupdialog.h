@@ -5,6 +5,7 @@
 
 class QLineEdit;
 class QCheckBox;
+class QSpinBox;
 
 namespace Ui {
 class AddGroupDialog;
@@ -24,6 +25,7 @@ public:
     QLineEdit *Source;
     QLineEdit *User;
     QLineEdit *Pass;
+    QSpinBox *Refresh;
 
 protected slots:
     void OnOK();
@@ -0,0 +1,129 @@
+#include "alertengine.h"
+#include "connectionpane.h"
+
+#include <QCoreApplication>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+
+// Lines waiting while a batch is being matched. Beyond that, the oldest
+// are dropped rather than falling further behind.
+static const int MaxPending = 100000;
+
+AlertEngine *AlertEngine::Instance()
+{
+    static AlertEngine *instance = 0;
+
+    if (instance == 0)
+        instance = new AlertEngine(QCoreApplication::instance());
+
+    return instance;
+}
+
+AlertEngine::AlertEngine(QObject *parent) :
+    QObject(parent),
+    busy(false)
+{
+    matcher = QSharedPointer<const AlertMatcher>(new AlertMatcher(QList<AlertRule>()));
+
+    worker = new QFutureWatcher<QList<Hit> >(this);
+    connect(worker, SIGNAL(finished()), this, SLOT(Scanned()));
+}
+
+AlertEngine::~AlertEngine()
+{
+    worker->waitForFinished();
+}
+
+// The batch being matched finishes with the rules it started with
+void AlertEngine::SetRules(QList<AlertRule> rules)
+{
+    matcher = QSharedPointer<const AlertMatcher>(new AlertMatcher(rules));
+}
+
+QList<AlertRule> AlertEngine::Rules()
+{
+    return matcher->Rules();
+}
+
+void AlertEngine::Scan(ConnectionPane *pane, QStringList lines)
+{
+    if (matcher->IsEmpty() || lines.isEmpty())
+        return;
+
+    pending.append(pane);
+    pendingLines.append(lines);
+
+    int total = 0;
+    for (int i = pendingLines.size() - 1 ; i >= 0 ; i--)
+    {
+        total += pendingLines.at(i).size();
+        if (total > MaxPending)
+        {
+            pending.erase(pending.begin(), pending.begin() + i + 1);
+            pendingLines.erase(pendingLines.begin(), pendingLines.begin() + i + 1);
+            break;
+        }
+    }
+
+    Start();
+}
+
+// The worker stops running before its finished() arrives, so a batch
+// counts as busy until Scanned() has taken its hits
+void AlertEngine::Start()
+{
+    if (busy || pending.isEmpty())
+        return;
+
+    busy = true;
+    scanning = pending;
+    running = matcher;
+    pending.clear();
+
+    worker->setFuture(QtConcurrent::run(&AlertEngine::Match, running, pendingLines));
+    pendingLines.clear();
+}
+
+// Runs on the worker, it only sees the matcher and copies of the lines
+QList<AlertEngine::Hit> AlertEngine::Match(QSharedPointer<const AlertMatcher> matcher, QList<QStringList> lines)
+{
+    QList<Hit> hits;
+
+    for (int i = 0 ; i < lines.size() ; i++)
+    {
+        const QStringList &batch = lines.at(i);
+
+        for (int j = 0 ; j < batch.size() ; j++)
+        {
+            foreach (int rule, matcher->Match(batch.at(j)))
+            {
+                Hit h;
+                h.Source = i;
+                h.Rule = rule;
+                h.Line = batch.at(j);
+                hits.append(h);
+            }
+        }
+    }
+
+    return hits;
+}
+
+// Consoles closed in the meantime don't alert
+void AlertEngine::Scanned()
+{
+    QList<Hit> hits = worker->result();
+
+    foreach (const Hit &h, hits)
+    {
+        ConnectionPane *pane = scanning.at(h.Source);
+        if (pane)
+            emit Alert(pane, running->Rules().at(h.Rule).ToString(), h.Line);
+    }
+
+    scanning.clear();
+    running.clear();
+    busy = false;
+
+    Start();
+}
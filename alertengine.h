@@ -0,0 +1,59 @@
+#ifndef ALERTENGINE_H
+#define ALERTENGINE_H
+
+#include <QObject>
+#include <QList>
+#include <QPointer>
+#include <QSharedPointer>
+#include <QStringList>
+
+#include "alertmatcher.h"
+
+class ConnectionPane;
+template <typename T> class QFutureWatcher;
+
+// Checks the lines every console receives against the alert rules. The
+// lines are collected as the polls come in and matched in batches on a
+// worker thread, one batch at a time.
+class AlertEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    static AlertEngine *Instance();
+
+    ~AlertEngine();
+
+    void SetRules(QList<AlertRule> rules);
+    QList<AlertRule> Rules();
+    void Scan(ConnectionPane *pane, QStringList lines);
+
+signals:
+    void Alert(ConnectionPane *pane, QString rule, QString line);
+
+protected slots:
+    void Scanned();
+
+protected:
+    struct Hit
+    {
+        int Source;
+        int Rule;
+        QString Line;
+    };
+
+    explicit AlertEngine(QObject *parent = 0);
+
+    void Start();
+    static QList<Hit> Match(QSharedPointer<const AlertMatcher> matcher, QList<QStringList> lines);
+
+    QSharedPointer<const AlertMatcher> matcher;
+    QSharedPointer<const AlertMatcher> running;
+    QList<QPointer<ConnectionPane> > pending;
+    QList<QStringList> pendingLines;
+    QList<QPointer<ConnectionPane> > scanning;
+    QFutureWatcher<QList<Hit> > *worker;
+    bool busy;
+};
+
+#endif // ALERTENGINE_H
@@ -0,0 +1,302 @@
+#include "alertmatcher.h"
+
+#include <QVarLengthArray>
+#include <QDebug>
+
+// Shorter pieces would let too many lines through to the expression
+static const int MinRequired = 3;
+
+AlertRule AlertRule::Parse(QString text)
+{
+    AlertRule rule;
+
+    text = text.trimmed();
+
+    rule.Regex = text.size() >= 2 && text.startsWith('/') && text.endsWith('/');
+    rule.Pattern = rule.Regex ? text.mid(1, text.size() - 2) : text;
+
+    return rule;
+}
+
+QString AlertRule::ToString() const
+{
+    if (Regex)
+        return QString("/") + Pattern + QString("/");
+
+    return Pattern;
+}
+
+AlertMatcher::AlertMatcher(QList<AlertRule> rules) :
+    rules(rules)
+{
+    regexes.resize(rules.size());
+    prefiltered.fill(false, rules.size());
+
+    for (int i = 0 ; i < rules.size() ; i++)
+    {
+        const AlertRule &rule = rules.at(i);
+        if (rule.Pattern.isEmpty())
+            continue;
+
+        if (!rule.Regex)
+        {
+            AddLiteral(rule.Pattern.toLower(), i);
+            continue;
+        }
+
+        regexes[i] = QRegularExpression(rule.Pattern, QRegularExpression::CaseInsensitiveOption);
+        if (!regexes[i].isValid())
+        {
+            qWarning() << "Alert rule" << rule.ToString() << "is not a valid expression:" << regexes[i].errorString();
+            continue;
+        }
+
+        QString required = RequiredText(rule.Pattern);
+        if (required.size() >= MinRequired)
+        {
+            AddLiteral(required.toLower(), i);
+            prefiltered[i] = true;
+        }
+    }
+
+    Build();
+}
+
+const QList<AlertRule> &AlertMatcher::Rules() const
+{
+    return rules;
+}
+
+bool AlertMatcher::IsEmpty() const
+{
+    return rules.isEmpty();
+}
+
+int AlertMatcher::Column(ushort c)
+{
+    if (c >= 128)
+        return Other;
+    if (c >= 'A' && c <= 'Z')
+        return c + ('a' - 'A');
+
+    return c;
+}
+
+// The longest run of plain characters that every match of the
+// expression has to contain. Anything with alternatives has none, and
+// groups and classes end a run.
+QString AlertMatcher::RequiredText(QString pattern)
+{
+    if (pattern.contains('|'))
+        return QString();
+
+    QString best;
+    QString run;
+
+    for (int i = 0 ; i < pattern.size() ; i++)
+    {
+        QChar c = pattern.at(i);
+
+        if (c == '\\' && i + 1 < pattern.size())
+        {
+            QChar e = pattern.at(++i);
+
+            // \d, \w, \b and friends are not characters of their own
+            if (e.isLetterOrNumber())
+            {
+                if (run.size() > best.size())
+                    best = run;
+                run.clear();
+            }
+            else
+            {
+                run.append(e);
+            }
+            continue;
+        }
+
+        if (c == '*' || c == '?' || c == '{')
+        {
+            // The character before is optional
+            if (!run.isEmpty())
+                run.chop(1);
+        }
+
+        if (c == '[' || c == '(' || c == '{')
+        {
+            // Skip to the end of the class, group or count
+            QChar close = (c == '[') ? QChar(']') : (c == '(') ? QChar(')') : QChar('}');
+            int level = 0;
+
+            for ( ; i < pattern.size() ; i++)
+            {
+                if (pattern.at(i) == '\\')
+                {
+                    i++;
+                    continue;
+                }
+                if (pattern.at(i) == c)
+                    level++;
+                else if (pattern.at(i) == close && --level == 0)
+                    break;
+            }
+        }
+
+        if (QString(".^$*+?(){}[]").contains(c))
+        {
+            if (run.size() > best.size())
+                best = run;
+            run.clear();
+            continue;
+        }
+
+        run.append(c);
+    }
+
+    if (run.size() > best.size())
+        best = run;
+
+    return best;
+}
+
+void AlertMatcher::AddLiteral(QString text, int rule)
+{
+    Literal l;
+    l.Text = text;
+    l.Rule = rule;
+    l.Verify = false;
+
+    // Characters outside ASCII share a column, so a hit has to be
+    // checked against the real text
+    for (int i = 0 ; i < text.size() ; i++)
+    {
+        if (text.at(i).unicode() >= 128)
+            l.Verify = true;
+    }
+
+    literals.append(l);
+}
+
+// Trie of the literals, then the failure links of Aho-Corasick folded
+// into the table so matching is a single lookup per character
+void AlertMatcher::Build()
+{
+    next.fill(-1, Columns);
+    out.resize(1);
+
+    for (int l = 0 ; l < literals.size() ; l++)
+    {
+        const QString &text = literals.at(l).Text;
+        int state = 0;
+
+        for (int i = 0 ; i < text.size() ; i++)
+        {
+            int col = Column(text.at(i).unicode());
+            int to = next[state * Columns + col];
+
+            if (to < 0)
+            {
+                to = out.size();
+                out.resize(to + 1);
+                next.resize((to + 1) * Columns);
+                for (int j = 0 ; j < Columns ; j++)
+                    next[to * Columns + j] = -1;
+
+                next[state * Columns + col] = to;
+            }
+
+            state = to;
+        }
+
+        out[state].append(l);
+    }
+
+    QVector<int> fail(out.size(), 0);
+    QVector<int> queue;
+    queue.reserve(out.size());
+
+    for (int col = 0 ; col < Columns ; col++)
+    {
+        int to = next[col];
+        if (to < 0)
+        {
+            next[col] = 0;
+        }
+        else
+        {
+            fail[to] = 0;
+            queue.append(to);
+        }
+    }
+
+    for (int q = 0 ; q < queue.size() ; q++)
+    {
+        int state = queue.at(q);
+
+        for (int col = 0 ; col < Columns ; col++)
+        {
+            int to = next[state * Columns + col];
+            int fallback = next[fail[state] * Columns + col];
+
+            if (to < 0)
+            {
+                next[state * Columns + col] = fallback;
+                continue;
+            }
+
+            fail[to] = fallback;
+            out[to] += out[fallback];
+            queue.append(to);
+        }
+    }
+}
+
+// Indices of the rules the line matches, in rule order
+QList<int> AlertMatcher::Match(const QString &line) const
+{
+    QList<int> matched;
+
+    QVarLengthArray<bool, 64> hits(rules.size());
+    for (int i = 0 ; i < hits.size() ; i++)
+        hits[i] = false;
+
+    if (!literals.isEmpty())
+    {
+        const ushort *p = line.utf16();
+        const int *table = next.constData();
+        int state = 0;
+
+        for (int i = 0 ; i < line.size() ; i++)
+        {
+            state = table[state * Columns + Column(p[i])];
+
+            const QVector<int> &found = out.at(state);
+            for (int f = 0 ; f < found.size() ; f++)
+            {
+                const Literal &l = literals.at(found.at(f));
+                if (!l.Verify || line.contains(l.Text, Qt::CaseInsensitive))
+                    hits[l.Rule] = true;
+            }
+        }
+    }
+
+    for (int i = 0 ; i < rules.size() ; i++)
+    {
+        if (!rules.at(i).Regex)
+        {
+            if (hits[i])
+                matched.append(i);
+            continue;
+        }
+
+        if (!regexes.at(i).isValid() || regexes.at(i).pattern().isEmpty())
+            continue;
+        if (prefiltered.at(i) && !hits[i])
+            continue;
+
+        if (regexes.at(i).match(line).hasMatch())
+            matched.append(i);
+    }
+
+    return matched;
+}
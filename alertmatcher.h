@@ -0,0 +1,60 @@
+#ifndef ALERTMATCHER_H
+#define ALERTMATCHER_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVector>
+#include <QRegularExpression>
+
+// A rule as the user writes it: plain text, or a regular expression
+// between slashes. Both ignore case.
+struct AlertRule
+{
+    QString Pattern;
+    bool Regex;
+
+    static AlertRule Parse(QString text);
+    QString ToString() const;
+};
+
+// All rules compiled into one matcher. The texts of the plain rules go
+// into an Aho-Corasick automaton, which finds all of them in one pass
+// over the line. A regular expression only runs on lines that contain
+// a piece of text it can't match without, found by the same pass.
+//
+// Once built it is never changed, so it can be used from any thread.
+class AlertMatcher
+{
+public:
+    explicit AlertMatcher(QList<AlertRule> rules);
+
+    QList<int> Match(const QString &line) const;
+    const QList<AlertRule> &Rules() const;
+    bool IsEmpty() const;
+
+protected:
+    // Printable ASCII gets a column each, everything else shares one
+    enum { Columns = 129, Other = 128 };
+
+    struct Literal
+    {
+        QString Text;
+        int Rule;
+        bool Verify;
+    };
+
+    static int Column(ushort c);
+    static QString RequiredText(QString pattern);
+    void AddLiteral(QString text, int rule);
+    void Build();
+
+    QList<AlertRule> rules;
+    QVector<QRegularExpression> regexes;
+    QVector<bool> prefiltered;
+    QVector<Literal> literals;
+    QVector<int> next;
+    QVector<QVector<int> > out;
+};
+
+#endif // ALERTMATCHER_H
@@ -0,0 +1,393 @@
+#include "commandhistory.h"
+
+#include <QCoreApplication>
+#include <QStandardPaths>
+#include <QDateTime>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QDebug>
+
+#include <algorithm>
+
+// The log is rewritten from memory on startup once it holds this many
+// more lines than there are distinct connection/command pairs.
+static const int CompactSlack = 20000;
+
+CommandHistory *CommandHistory::Instance()
+{
+    static CommandHistory *instance = 0;
+
+    if (instance == 0)
+        instance = new CommandHistory(QCoreApplication::instance());
+
+    return instance;
+}
+
+CommandHistory::CommandHistory(QObject *parent) :
+    QObject(parent),
+    log(0)
+{
+    Load();
+
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+
+    log = new QFile(FileName(), this);
+    if (!log->open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text))
+        qWarning() << "Could not open command history" << FileName();
+}
+
+CommandHistory::~CommandHistory()
+{
+}
+
+QString CommandHistory::FileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QString("/history.log");
+}
+
+void CommandHistory::RecencyList::Touch(int id, int count)
+{
+    QHash<int, int>::iterator it = position.find(id);
+    if (it != position.end())
+    {
+        order[it.value()] = -1;
+        dead++;
+        it.value() = order.size();
+    }
+    else
+    {
+        position.insert(id, order.size());
+    }
+
+    order.append(id);
+    uses[id] += count;
+
+    if (dead > 1024 && dead > order.size() / 2)
+        Compact();
+}
+
+void CommandHistory::RecencyList::Compact()
+{
+    QVector<int> live;
+    live.reserve(order.size() - dead);
+
+    for (int i = 0 ; i < order.size() ; i++)
+    {
+        if (order.at(i) < 0)
+            continue;
+
+        position[order.at(i)] = live.size();
+        live.append(order.at(i));
+    }
+
+    order = live;
+    dead = 0;
+}
+
+int CommandHistory::Use(QString connection, QString command, int count, qint64 when)
+{
+    int id = byCommand.value(command, -1);
+
+    if (id < 0)
+    {
+        Entry e;
+        e.Command = command;
+        e.Count = 0;
+        e.LastUsed = 0;
+
+        entries.append(e);
+        id = entries.size() - 1;
+        byCommand[command] = id;
+
+        // Commands are never removed, so the posting lists only grow
+        foreach (quint64 t, Trigrams(command.toLower()))
+            trigrams[t].append(id);
+    }
+
+    Entry &e = entries[id];
+    e.Count += count;
+    if (when > e.LastUsed)
+        e.LastUsed = when;
+
+    connections[connection].Touch(id, count);
+
+    return id;
+}
+
+void CommandHistory::Add(QString connection, QString command)
+{
+    if (command.trimmed() == "")
+        return;
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+    int id = Use(connection, command, 1, now);
+
+    // A match for the running search may be new or move up, either way
+    // its cached results are out of date
+    if (lastQuery != "" && command.contains(lastQuery, Qt::CaseInsensitive))
+        lastQuery = QString();
+
+    if (log && log->isOpen())
+    {
+        QString line = QString::number(now) + "\t1\t" + Escape(connection) + "\t" + Escape(command) + "\n";
+        log->write(line.toUtf8());
+        log->flush();
+    }
+}
+
+int CommandHistory::End(QString connection)
+{
+    if (!connections.contains(connection))
+        return 0;
+
+    return connections[connection].order.size();
+}
+
+QString CommandHistory::Older(QString connection, int *cursor)
+{
+    if (!connections.contains(connection))
+        return QString();
+
+    const QVector<int> &order = connections[connection].order;
+
+    int i = qMin(*cursor, order.size()) - 1;
+    while (i >= 0 && order.at(i) < 0)
+        i--;
+
+    if (i < 0)
+        return QString();
+
+    *cursor = i;
+    return entries.at(order.at(i)).Command;
+}
+
+QString CommandHistory::Newer(QString connection, int *cursor)
+{
+    if (!connections.contains(connection))
+        return QString();
+
+    const QVector<int> &order = connections[connection].order;
+
+    int i = *cursor + 1;
+    while (i < order.size() && order.at(i) < 0)
+        i++;
+
+    *cursor = qMin(i, order.size());
+
+    if (i >= order.size())
+        return QString();
+
+    return entries.at(order.at(i)).Command;
+}
+
+QVector<quint64> CommandHistory::Trigrams(QString text)
+{
+    QVector<quint64> result;
+
+    for (int i = 0 ; i + 3 <= text.size() ; i++)
+    {
+        quint64 t = (quint64(text.at(i).unicode()) << 32) |
+                    (quint64(text.at(i + 1).unicode()) << 16) |
+                    quint64(text.at(i + 2).unicode());
+        result.append(t);
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
+// Commands that may contain the text, to be checked with contains().
+// Text of three or more letters is looked up by its rarest trigram,
+// shorter text has to go through all commands.
+QList<int> CommandHistory::Candidates(QString text)
+{
+    QList<int> result;
+
+    if (text.size() < 3)
+    {
+        result.reserve(entries.size());
+        for (int id = 0 ; id < entries.size() ; id++)
+            result.append(id);
+        return result;
+    }
+
+    const QVector<int> *best = 0;
+
+    foreach (quint64 t, Trigrams(text.toLower()))
+    {
+        QHash<quint64, QVector<int> >::const_iterator it = trigrams.constFind(t);
+        if (it == trigrams.constEnd())
+            return result;
+
+        if (best == 0 || it.value().size() < best->size())
+            best = &it.value();
+    }
+
+    if (best)
+    {
+        result.reserve(best->size());
+        foreach (int id, *best)
+            result.append(id);
+    }
+
+    return result;
+}
+
+// Most used first, then most recently used
+void CommandHistory::Rank(QList<int> *results)
+{
+    const QVector<Entry> &all = entries;
+    std::stable_sort(results->begin(), results->end(), [&all](int a, int b) -> bool {
+        if (all.at(a).Count != all.at(b).Count)
+            return all.at(a).Count > all.at(b).Count;
+        return all.at(a).LastUsed > all.at(b).LastUsed;
+    });
+}
+
+// While the user keeps typing, each query extends the previous one and
+// only the previous matches need to be checked again. They are already
+// ranked, and filtering keeps their order.
+QList<int> CommandHistory::Search(QString text)
+{
+    QList<int> results;
+
+    if (text == "")
+        return results;
+
+    if (lastQuery != "" && text.startsWith(lastQuery, Qt::CaseInsensitive))
+    {
+        foreach (int id, lastResults)
+        {
+            if (entries.at(id).Command.contains(text, Qt::CaseInsensitive))
+                results.append(id);
+        }
+    }
+    else
+    {
+        foreach (int id, Candidates(text))
+        {
+            if (entries.at(id).Command.contains(text, Qt::CaseInsensitive))
+                results.append(id);
+        }
+
+        Rank(&results);
+    }
+
+    lastQuery = text;
+    lastResults = results;
+
+    return results;
+}
+
+QString CommandHistory::Command(int id)
+{
+    return entries.at(id).Command;
+}
+
+int CommandHistory::Frequency(int id)
+{
+    return entries.at(id).Count;
+}
+
+void CommandHistory::Load()
+{
+    QFile f(FileName());
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text))
+        return;
+
+    QByteArray data = f.readAll();
+    f.close();
+
+    int lines = 0;
+    int pos = 0;
+    while (pos < data.size())
+    {
+        int eol = data.indexOf('\n', pos);
+        if (eol < 0)
+            eol = data.size();
+
+        QList<QByteArray> fields = data.mid(pos, eol - pos).split('\t');
+        pos = eol + 1;
+
+        if (fields.count() != 4)
+            continue;
+
+        Use(Unescape(QString::fromUtf8(fields.at(2))),
+            Unescape(QString::fromUtf8(fields.at(3))),
+            qMax(1, fields.at(1).toInt()),
+            fields.at(0).toLongLong());
+        lines++;
+    }
+
+    int pairs = 0;
+    for (QHash<QString, RecencyList>::iterator it = connections.begin() ; it != connections.end() ; ++it)
+        pairs += it.value().position.size();
+
+    if (lines - pairs > CompactSlack)
+        Rewrite();
+}
+
+// Replace the log with one line per connection and command, carrying
+// the use count, in order of last use.
+void CommandHistory::Rewrite()
+{
+    QSaveFile f(FileName());
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text))
+        return;
+
+    for (QHash<QString, RecencyList>::iterator it = connections.begin() ; it != connections.end() ; ++it)
+    {
+        const RecencyList &list = it.value();
+        QString connection = Escape(it.key());
+
+        for (int i = 0 ; i < list.order.size() ; i++)
+        {
+            int id = list.order.at(i);
+            if (id < 0)
+                continue;
+
+            QString line = QString::number(entries.at(id).LastUsed) + "\t" +
+                           QString::number(list.uses.value(id)) + "\t" +
+                           connection + "\t" + Escape(entries.at(id).Command) + "\n";
+            f.write(line.toUtf8());
+        }
+    }
+
+    if (!f.commit())
+        qWarning() << "Could not compact command history" << FileName();
+}
+
+QString CommandHistory::Escape(QString text)
+{
+    return text.replace("\\", "\\\\").replace("\t", "\\t").replace("\n", "\\n");
+}
+
+QString CommandHistory::Unescape(QString text)
+{
+    QString result;
+    result.reserve(text.size());
+
+    for (int i = 0 ; i < text.size() ; i++)
+    {
+        if (text.at(i) == QChar('\\') && i + 1 < text.size())
+        {
+            i++;
+            if (text.at(i) == QChar('t'))
+                result += QChar('\t');
+            else if (text.at(i) == QChar('n'))
+                result += QChar('\n');
+            else
+                result += text.at(i);
+        }
+        else
+        {
+            result += text.at(i);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,83 @@
+#ifndef COMMANDHISTORY_H
+#define COMMANDHISTORY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QList>
+
+class QFile;
+
+// Commands entered in all sessions. Every use is appended to a log file;
+// in memory each distinct command is kept once with its use count, and
+// per connection (host:port) and globally in order of last use. Searches
+// go through an index of the letter trigrams of the commands.
+class CommandHistory : public QObject
+{
+    Q_OBJECT
+
+public:
+    static CommandHistory *Instance();
+    ~CommandHistory();
+
+    void Add(QString connection, QString command);
+
+    // Walking a connection's history. Start with cursor = End(), each
+    // call moves it and returns the command there, or a null string when
+    // there is nothing further in that direction.
+    int End(QString connection);
+    QString Older(QString connection, int *cursor);
+    QString Newer(QString connection, int *cursor);
+
+    // Ids of all commands containing text, most used first
+    QList<int> Search(QString text);
+    QString Command(int id);
+    int Frequency(int id);
+
+protected:
+    explicit CommandHistory(QObject *parent = 0);
+
+    struct Entry
+    {
+        QString Command;
+        int Count;
+        qint64 LastUsed;
+    };
+
+    // Distinct ids in order of last use. Moving an id to the end leaves
+    // a hole that is squeezed out once there are enough of them.
+    struct RecencyList
+    {
+        RecencyList() : dead(0) {}
+
+        void Touch(int id, int count);
+        void Compact();
+
+        QVector<int> order;
+        QHash<int, int> position;
+        QHash<int, int> uses;
+        int dead;
+    };
+
+    int Use(QString connection, QString command, int count, qint64 when);
+    static QVector<quint64> Trigrams(QString text);
+    QList<int> Candidates(QString text);
+    void Rank(QList<int> *results);
+    void Load();
+    void Rewrite();
+    QString FileName();
+    static QString Escape(QString text);
+    static QString Unescape(QString text);
+
+    QVector<Entry> entries;
+    QHash<QString, int> byCommand;
+    QHash<QString, RecencyList> connections;
+    QHash<quint64, QVector<int> > trigrams;
+    QString lastQuery;
+    QList<int> lastResults;
+    QFile *log;
+};
+
+#endif // COMMANDHISTORY_H
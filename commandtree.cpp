@@ -0,0 +1,370 @@
+#include "commandtree.h"
+
+#include <QDataStream>
+#include <QIODevice>
+
+CommandTree::CommandTree()
+{
+    Clear();
+}
+
+void CommandTree::Clear()
+{
+    names.clear();
+    commands.clear();
+    pending.clear();
+    index.Clear();
+
+    Node root;
+    root.NameOffset = 0;
+    root.NameLength = 0;
+    root.FirstChild = 1;
+    root.ChildCount = 0;
+    root.Command = -1;
+
+    nodes.clear();
+    nodes.append(root);
+}
+
+// Find or create the build time node for a path
+int CommandTree::PendingNodeFor(const QStringList &path)
+{
+    if (pending.isEmpty())
+    {
+        PendingNode root;
+        root.Command = -1;
+        pending.append(root);
+    }
+
+    int node = 0;
+
+    for (int i = 0 ; i < path.size() ; i++)
+    {
+        int next = pending[node].Children.value(path.at(i), -1);
+
+        if (next < 0)
+        {
+            PendingNode n;
+            n.Command = -1;
+            pending.append(n);
+
+            next = pending.size() - 1;
+            pending[node].Children[path.at(i)] = next;
+        }
+
+        node = next;
+    }
+
+    return node;
+}
+
+void CommandTree::InsertLevel(QStringList path)
+{
+    PendingNodeFor(path);
+}
+
+// Add a command. A later insert on the same path replaces the command.
+void CommandTree::Insert(QStringList path, const CommandData &cmd)
+{
+    int node = PendingNodeFor(path);
+
+    if (pending[node].Command >= 0)
+    {
+        int id = pending[node].Command;
+
+        index.Remove(id, commands.at(id));
+        commands[id] = cmd;
+        index.Add(id, cmd);
+    }
+    else
+    {
+        commands.append(cmd);
+        pending[node].Command = commands.size() - 1;
+
+        index.Add(commands.size() - 1, cmd);
+    }
+}
+
+// Lay the tree out breadth first, so that the children of every node end
+// up in one sorted run, and drop the build time structures.
+void CommandTree::Finalize()
+{
+    nodes.clear();
+    names.clear();
+
+    if (pending.isEmpty())
+    {
+        Clear();
+        return;
+    }
+
+    QVector<int> order;
+    order.reserve(pending.size());
+    nodes.reserve(pending.size());
+
+    Node root;
+    root.NameOffset = 0;
+    root.NameLength = 0;
+    root.FirstChild = 1;
+    root.ChildCount = 0;
+    root.Command = pending.at(0).Command;
+
+    nodes.append(root);
+    order.append(0);
+
+    for (int i = 0 ; i < order.size() ; i++)
+    {
+        const PendingNode &p = pending.at(order.at(i));
+
+        nodes[i].FirstChild = nodes.size();
+        nodes[i].ChildCount = p.Children.size();
+
+        for (QMap<QString, int>::const_iterator it = p.Children.constBegin() ; it != p.Children.constEnd() ; ++it)
+        {
+            Node n;
+            n.NameOffset = names.size();
+            n.NameLength = it.key().size();
+            n.FirstChild = 0;
+            n.ChildCount = 0;
+            n.Command = pending.at(it.value()).Command;
+
+            names += it.key();
+
+            nodes.append(n);
+            order.append(it.value());
+        }
+    }
+
+    names.squeeze();
+    nodes.squeeze();
+    commands.squeeze();
+
+    pending.clear();
+    pending.squeeze();
+
+    index.Finalize();
+}
+
+int CommandTree::Root() const
+{
+    return 0;
+}
+
+int CommandTree::FirstChild(int node) const
+{
+    return nodes.at(node).FirstChild;
+}
+
+int CommandTree::ChildCount(int node) const
+{
+    return nodes.at(node).ChildCount;
+}
+
+QStringRef CommandTree::NameRef(int node) const
+{
+    const Node &n = nodes.at(node);
+
+    return QStringRef(&names, n.NameOffset, n.NameLength);
+}
+
+QString CommandTree::Name(int node) const
+{
+    return NameRef(node).toString();
+}
+
+const CommandData *CommandTree::Command(int node) const
+{
+    int index = nodes.at(node).Command;
+    if (index < 0)
+        return 0;
+
+    return &commands.at(index);
+}
+
+// Ids of the commands whose help matches the query, best first
+QList<int> CommandTree::Apropos(QString query, int limit) const
+{
+    return index.Search(query, limit);
+}
+
+const CommandData *CommandTree::CommandAt(int id) const
+{
+    if (id < 0 || id >= commands.size())
+        return 0;
+
+    return &commands.at(id);
+}
+
+// Roughly what the tree takes up, for the memory accounting
+qint64 CommandTree::Bytes() const
+{
+    qint64 bytes = sizeof(CommandTree) + names.capacity() * 2 + nodes.capacity() * sizeof(Node);
+
+    bytes += commands.capacity() * sizeof(CommandData);
+    foreach (const CommandData &cmd, commands)
+        bytes += (cmd.Module.capacity() + cmd.HelpText.capacity() + cmd.LongHelp.capacity() + cmd.Description.capacity()) * 2;
+
+    return bytes + index.Bytes();
+}
+
+// First child of node that does not sort before key
+int CommandTree::LowerBound(int node, const QString &key) const
+{
+    int lo = nodes.at(node).FirstChild;
+    int hi = lo + nodes.at(node).ChildCount;
+
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+
+        if (NameRef(mid).compare(key) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+// Exact match, or -1
+int CommandTree::Child(int node, const QString &name) const
+{
+    int i = LowerBound(node, name);
+
+    if (i < nodes.at(node).FirstChild + nodes.at(node).ChildCount && NameRef(i) == name)
+        return i;
+
+    return -1;
+}
+
+// All children of node starting with prefix are the nodes in [first, last)
+void CommandTree::PrefixRange(int node, const QString &prefix, int *first, int *last) const
+{
+    int lo = LowerBound(node, prefix);
+    int hi = nodes.at(node).FirstChild + nodes.at(node).ChildCount;
+
+    *first = lo;
+
+    // Names sharing the prefix compare equal to it when cut to its
+    // length, everything after the range compares greater.
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        const Node &n = nodes.at(mid);
+
+        QStringRef head(&names, n.NameOffset, qMin(n.NameLength, prefix.size()));
+        if (head.compare(prefix) <= 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    *last = lo;
+}
+
+// Write a finalized tree. Handlers are stored as their index in the
+// handlers table, since function pointers don't survive a restart.
+void CommandTree::Save(QDataStream &out, const QVector<CommandFn> &handlers) const
+{
+    out << names;
+
+    out << quint32(nodes.size());
+    for (int i = 0 ; i < nodes.size() ; i++)
+    {
+        const Node &n = nodes.at(i);
+        out << qint32(n.NameOffset) << qint32(n.NameLength) << qint32(n.FirstChild) << qint32(n.ChildCount) << qint32(n.Command);
+    }
+
+    out << quint32(commands.size());
+    for (int i = 0 ; i < commands.size() ; i++)
+    {
+        const CommandData &cmd = commands.at(i);
+        out << cmd.Module << cmd.HelpText << cmd.LongHelp << cmd.Description << qint32(handlers.indexOf(cmd.fn));
+    }
+}
+
+// The least a node and a command take up as written by Save()
+static const int NodeBytes = 5 * 4;
+static const int CommandBytes = 4 * 4 + 4;
+
+// Read a tree written by Save(). Returns false, leaving an empty tree,
+// if the data is truncated or doesn't describe a valid tree.
+bool CommandTree::Load(QDataStream &in, const QVector<CommandFn> &handlers)
+{
+    Clear();
+
+    QString loadedNames;
+    QVector<Node> loadedNodes;
+    QVector<CommandData> loadedCommands;
+    quint32 count;
+
+    in >> loadedNames;
+
+    in >> count;
+    if (in.status() != QDataStream::Ok || count == 0)
+        return false;
+
+    // Counts come from the file, don't let them ask for more than the
+    // rest of it could hold
+    if (in.device() == 0 || qint64(count) * NodeBytes > in.device()->bytesAvailable())
+        return false;
+
+    loadedNodes.reserve(count);
+    for (quint32 i = 0 ; i < count && in.status() == QDataStream::Ok ; i++)
+    {
+        qint32 nameOffset, nameLength, firstChild, childCount, command;
+        in >> nameOffset >> nameLength >> firstChild >> childCount >> command;
+
+        Node n;
+        n.NameOffset = nameOffset;
+        n.NameLength = nameLength;
+        n.FirstChild = firstChild;
+        n.ChildCount = childCount;
+        n.Command = command;
+        loadedNodes.append(n);
+    }
+
+    in >> count;
+    if (in.status() != QDataStream::Ok || qint64(count) * CommandBytes > in.device()->bytesAvailable())
+        return false;
+
+    loadedCommands.reserve(count);
+    for (quint32 i = 0 ; i < count && in.status() == QDataStream::Ok ; i++)
+    {
+        CommandData cmd;
+        qint32 handler;
+
+        in >> cmd.Module >> cmd.HelpText >> cmd.LongHelp >> cmd.Description >> handler;
+
+        cmd.fn = 0;
+        if (handler >= 0 && handler < handlers.size())
+            cmd.fn = handlers.at(handler);
+
+        loadedCommands.append(cmd);
+    }
+
+    if (in.status() != QDataStream::Ok)
+        return false;
+
+    for (int i = 0 ; i < loadedNodes.size() ; i++)
+    {
+        const Node &n = loadedNodes.at(i);
+
+        if (n.NameOffset < 0 || n.NameLength < 0 || n.NameOffset + n.NameLength > loadedNames.size())
+            return false;
+        if (n.ChildCount < 0 || (n.ChildCount > 0 && (n.FirstChild <= i || n.FirstChild + n.ChildCount > loadedNodes.size())))
+            return false;
+        if (n.Command < -1 || n.Command >= loadedCommands.size())
+            return false;
+    }
+
+    names = loadedNames;
+    nodes = loadedNodes;
+    commands = loadedCommands;
+
+    for (int i = 0 ; i < commands.size() ; i++)
+        index.Add(i, commands.at(i));
+    index.Finalize();
+
+    return true;
+}
@@ -0,0 +1,88 @@
+#ifndef COMMANDTREE_H
+#define COMMANDTREE_H
+
+#include <QString>
+#include <QStringRef>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QList>
+
+#include "helpindex.h"
+
+class ConnectionPane;
+class QDataStream;
+
+typedef void (*CommandFn)(QString module, ConnectionPane *instance, QStringList args);
+
+struct CommandData
+{
+public:
+    QString Module;
+    QString HelpText;
+    QString LongHelp;
+    QString Description;
+    CommandFn fn;
+};
+
+// The command help tree as a compact trie. All nodes live in one array
+// and their names in one string. The children of a node are stored next
+// to each other and sorted by name, so all options starting with a prefix
+// form a single range that is found by binary search.
+//
+// The tree is filled with Insert() and becomes searchable after
+// Finalize(). Nodes are referred to by index, the root is always 0.
+class CommandTree
+{
+public:
+    CommandTree();
+
+    void Clear();
+    void InsertLevel(QStringList path);
+    void Insert(QStringList path, const CommandData &cmd);
+    void Finalize();
+
+    void Save(QDataStream &out, const QVector<CommandFn> &handlers) const;
+    bool Load(QDataStream &in, const QVector<CommandFn> &handlers);
+
+    int Root() const;
+    int Child(int node, const QString &name) const;
+    void PrefixRange(int node, const QString &prefix, int *first, int *last) const;
+    int FirstChild(int node) const;
+    int ChildCount(int node) const;
+    QString Name(int node) const;
+    QStringRef NameRef(int node) const;
+    const CommandData *Command(int node) const;
+
+    QList<int> Apropos(QString query, int limit) const;
+    const CommandData *CommandAt(int id) const;
+
+    qint64 Bytes() const;
+
+protected:
+    struct Node
+    {
+        int NameOffset;
+        int NameLength;
+        int FirstChild;
+        int ChildCount;
+        int Command;
+    };
+
+    struct PendingNode
+    {
+        QMap<QString, int> Children;
+        int Command;
+    };
+
+    int PendingNodeFor(const QStringList &path);
+    int LowerBound(int node, const QString &key) const;
+
+    QString names;
+    QVector<Node> nodes;
+    QVector<CommandData> commands;
+    QVector<PendingNode> pending;
+    HelpIndex index;
+};
+
+#endif // COMMANDTREE_H
@@ -0,0 +1,76 @@
+#include "connectionfilter.h"
+#include "connectionmodel.h"
+#include "connectionindex.h"
+#include "connectiondata.h"
+
+#include <QTimer>
+
+ConnectionFilterModel::ConnectionFilterModel(ConnectionModel *model, QObject *parent) :
+    QSortFilterProxyModel(parent),
+    model(model)
+{
+    index = new ConnectionIndex(model, this);
+
+    // Refreshes come in batches, filter again once they settle
+    refilterTimer = new QTimer(this);
+    refilterTimer->setSingleShot(true);
+    refilterTimer->setInterval(0);
+    connect(refilterTimer, SIGNAL(timeout()), this, SLOT(Refilter()));
+    connect(index, SIGNAL(Updated()), this, SLOT(IndexUpdated()));
+
+    setSourceModel(model);
+    setDynamicSortFilter(true);
+    sort(0, Qt::AscendingOrder);
+}
+
+bool ConnectionFilterModel::IsFiltering()
+{
+    return !filter.isEmpty();
+}
+
+void ConnectionFilterModel::SetFilter(QString text)
+{
+    filter = text.trimmed();
+
+    Refilter();
+}
+
+void ConnectionFilterModel::IndexUpdated()
+{
+    if (IsFiltering())
+        refilterTimer->start();
+}
+
+void ConnectionFilterModel::Refilter()
+{
+    matches.clear();
+    groupsWithMatches.clear();
+
+    if (IsFiltering())
+    {
+        matches = index->Search(filter);
+
+        foreach (QUuid uuid, matches)
+        {
+            ConnectionData *c = model->Connection(uuid);
+            if (c && !c->Group.isNull())
+                groupsWithMatches.insert(c->Group);
+        }
+    }
+
+    invalidateFilter();
+}
+
+bool ConnectionFilterModel::filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const
+{
+    if (filter.isEmpty())
+        return true;
+
+    QUuid uuid = model->UuidOf(model->index(sourceRow, 0, sourceParent));
+
+    if (matches.contains(uuid) || groupsWithMatches.contains(uuid))
+        return true;
+
+    // Members of a group whose name matches
+    return sourceParent.isValid() && matches.contains(model->UuidOf(sourceParent));
+}
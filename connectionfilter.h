@@ -0,0 +1,41 @@
+#ifndef CONNECTIONFILTER_H
+#define CONNECTIONFILTER_H
+
+#include <QSortFilterProxyModel>
+#include <QSet>
+#include <QUuid>
+#include <QString>
+
+class ConnectionModel;
+class ConnectionIndex;
+class QTimer;
+
+// Sorts the connection tree by name and narrows it down to the entries
+// matching the filter text. A group is shown if its name matches, with
+// all its members, or if any of its members match.
+class ConnectionFilterModel : public QSortFilterProxyModel
+{
+    Q_OBJECT
+
+public:
+    explicit ConnectionFilterModel(ConnectionModel *model, QObject *parent = 0);
+
+    void SetFilter(QString text);
+    bool IsFiltering();
+
+protected slots:
+    void IndexUpdated();
+    void Refilter();
+
+protected:
+    bool filterAcceptsRow(int sourceRow, const QModelIndex &sourceParent) const;
+
+    ConnectionModel *model;
+    ConnectionIndex *index;
+    QTimer *refilterTimer;
+    QString filter;
+    QSet<QUuid> matches;
+    QSet<QUuid> groupsWithMatches;
+};
+
+#endif // CONNECTIONFILTER_H
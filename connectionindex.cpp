@@ -0,0 +1,262 @@
+#include "connectionindex.h"
+#include "connectionmodel.h"
+#include "connectiondata.h"
+#include "groupdata.h"
+
+#include <QRegExp>
+
+#include <algorithm>
+
+ConnectionIndex::ConnectionIndex(ConnectionModel *model, QObject *parent) :
+    QObject(parent),
+    model(model),
+    wordsSorted(true),
+    dead(0)
+{
+    connect(model, SIGNAL(rowsInserted(const QModelIndex &, int, int)), this, SLOT(RowsInserted(const QModelIndex &, int, int)));
+    connect(model, SIGNAL(rowsAboutToBeRemoved(const QModelIndex &, int, int)), this, SLOT(RowsAboutToBeRemoved(const QModelIndex &, int, int)));
+    connect(model, SIGNAL(dataChanged(const QModelIndex &, const QModelIndex &, const QVector<int> &)), this, SLOT(DataChanged(const QModelIndex &, const QModelIndex &, const QVector<int> &)));
+    connect(model, SIGNAL(modelReset()), this, SLOT(Reset()));
+
+    Rebuild();
+}
+
+// What a record can be found by, in lower case
+QString ConnectionIndex::TextFor(QUuid uuid)
+{
+    GroupData *grp = model->Group(uuid);
+    if (grp)
+        return grp->Name.toLower();
+
+    ConnectionData *c = model->Connection(uuid);
+    if (c == 0)
+        return QString();
+
+    QString port = QString::number(c->Port);
+
+    return QString("%1 %2 %2:%3 %3").arg(c->Name, c->Host, port).toLower();
+}
+
+QVector<quint64> ConnectionIndex::Trigrams(QString text)
+{
+    QVector<quint64> result;
+
+    for (int i = 0 ; i + 3 <= text.size() ; i++)
+    {
+        quint64 t = (quint64(text.at(i).unicode()) << 32) |
+                    (quint64(text.at(i + 1).unicode()) << 16) |
+                    quint64(text.at(i + 2).unicode());
+        result.append(t);
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+
+    return result;
+}
+
+// Ids are never reused, so the posting lists only ever point to the
+// record they were made for or to a dead id.
+void ConnectionIndex::Add(QUuid uuid)
+{
+    if (ids.contains(uuid))
+        Remove(uuid);
+
+    QString text = TextFor(uuid);
+    if (text.isEmpty())
+        return;
+
+    int id = uuids.size();
+    uuids.append(uuid);
+    texts.append(text);
+    ids[uuid] = id;
+
+    foreach (quint64 t, Trigrams(text))
+        trigrams[t].append(id);
+
+    foreach (QString w, text.split(' ', QString::SkipEmptyParts))
+    {
+        Word word;
+        word.Text = w;
+        word.Id = id;
+        words.append(word);
+    }
+    wordsSorted = false;
+}
+
+void ConnectionIndex::Remove(QUuid uuid)
+{
+    if (!ids.contains(uuid))
+        return;
+
+    int id = ids.take(uuid);
+    uuids[id] = QUuid();
+    texts[id].clear();
+    dead++;
+
+    if (dead > 1024 && dead > ids.size())
+        Rebuild();
+}
+
+void ConnectionIndex::Rebuild()
+{
+    ids.clear();
+    uuids.clear();
+    texts.clear();
+    trigrams.clear();
+    words.clear();
+    wordsSorted = true;
+    dead = 0;
+
+    foreach (GroupData *grp, model->Groups())
+        Add(grp->Uuid);
+    foreach (ConnectionData *c, model->Connections())
+        Add(c->Uuid);
+}
+
+void ConnectionIndex::RowsInserted(const QModelIndex &parent, int first, int last)
+{
+    for (int i = first ; i <= last ; i++)
+    {
+        QModelIndex index = model->index(i, 0, parent);
+        Add(model->UuidOf(index));
+
+        // A group comes with its members
+        for (int j = 0 ; j < model->rowCount(index) ; j++)
+            Add(model->UuidOf(model->index(j, 0, index)));
+    }
+
+    emit Updated();
+}
+
+void ConnectionIndex::RowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+    for (int i = first ; i <= last ; i++)
+    {
+        QModelIndex index = model->index(i, 0, parent);
+
+        for (int j = 0 ; j < model->rowCount(index) ; j++)
+            Remove(model->UuidOf(model->index(j, 0, index)));
+
+        Remove(model->UuidOf(index));
+    }
+
+    emit Updated();
+}
+
+void ConnectionIndex::DataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles)
+{
+    // No roles means everything changed
+    if (!roles.isEmpty() && !roles.contains(Qt::DisplayRole))
+        return;
+
+    for (int i = topLeft.row() ; i <= bottomRight.row() ; i++)
+        Add(model->UuidOf(model->index(i, 0, topLeft.parent())));
+
+    emit Updated();
+}
+
+void ConnectionIndex::Reset()
+{
+    Rebuild();
+
+    emit Updated();
+}
+
+bool ConnectionIndex::Matches(const QString &text, const QString &word)
+{
+    if (word.size() >= 3)
+        return text.contains(word);
+
+    if (text.startsWith(word))
+        return true;
+
+    int at = 0;
+    while ((at = text.indexOf(' ', at)) >= 0)
+    {
+        at++;
+        if (text.midRef(at, word.size()) == word)
+            return true;
+    }
+
+    return false;
+}
+
+// Records that may match a word, to be checked with Matches()
+QVector<int> ConnectionIndex::Candidates(QString word)
+{
+    QVector<int> result;
+
+    if (word.size() >= 3)
+    {
+        // The rarest trigram of the word narrows it down the most
+        const QVector<int> *best = 0;
+
+        foreach (quint64 t, Trigrams(word))
+        {
+            QHash<quint64, QVector<int> >::const_iterator it = trigrams.constFind(t);
+            if (it == trigrams.constEnd())
+                return result;
+
+            if (best == 0 || it.value().size() < best->size())
+                best = &it.value();
+        }
+
+        if (best)
+            result = *best;
+
+        return result;
+    }
+
+    if (!wordsSorted)
+    {
+        std::sort(words.begin(), words.end());
+        wordsSorted = true;
+    }
+
+    Word key;
+    key.Text = word;
+
+    QVector<Word>::const_iterator it = std::lower_bound(words.constBegin(), words.constEnd(), key);
+    for ( ; it != words.constEnd() && it->Text.startsWith(word) ; ++it)
+        result.append(it->Id);
+
+    return result;
+}
+
+QSet<QUuid> ConnectionIndex::Search(QString query)
+{
+    QSet<QUuid> result;
+
+    QStringList queryWords = query.toLower().split(QRegExp("\\s+"), QString::SkipEmptyParts);
+    if (queryWords.isEmpty())
+        return result;
+
+    // Look up the longest word, check the others on what it found
+    std::sort(queryWords.begin(), queryWords.end(), [](const QString &a, const QString &b) -> bool {
+        return a.size() > b.size();
+    });
+
+    foreach (int id, Candidates(queryWords.first()))
+    {
+        if (uuids.at(id).isNull())
+            continue;
+
+        const QString &text = texts.at(id);
+
+        bool ok = true;
+        foreach (QString w, queryWords)
+        {
+            if (!Matches(text, w))
+            {
+                ok = false;
+                break;
+            }
+        }
+
+        if (ok)
+            result.insert(uuids.at(id));
+    }
+
+    return result;
+}
@@ -0,0 +1,67 @@
+#ifndef CONNECTIONINDEX_H
+#define CONNECTIONINDEX_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+#include <QString>
+#include <QStringList>
+#include <QUuid>
+#include <QModelIndex>
+
+class ConnectionModel;
+
+// Search index over the names of groups and the names, hosts and ports
+// of connections. It follows the model, so it stays current as dynamic
+// groups refresh.
+//
+// Every word of a query has to match. Words of three or more letters
+// match anywhere, through an index of letter trigrams; shorter words
+// match the start of a word, through a sorted word list.
+class ConnectionIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ConnectionIndex(ConnectionModel *model, QObject *parent = 0);
+
+    QSet<QUuid> Search(QString query);
+
+signals:
+    void Updated();
+
+protected slots:
+    void RowsInserted(const QModelIndex &parent, int first, int last);
+    void RowsAboutToBeRemoved(const QModelIndex &parent, int first, int last);
+    void DataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight, const QVector<int> &roles);
+    void Reset();
+
+protected:
+    struct Word
+    {
+        QString Text;
+        int Id;
+
+        bool operator<(const Word &other) const { return Text < other.Text; }
+    };
+
+    void Add(QUuid uuid);
+    void Remove(QUuid uuid);
+    void Rebuild();
+    QString TextFor(QUuid uuid);
+    static QVector<quint64> Trigrams(QString text);
+    static bool Matches(const QString &text, const QString &word);
+    QVector<int> Candidates(QString word);
+
+    ConnectionModel *model;
+    QHash<QUuid, int> ids;
+    QVector<QUuid> uuids;
+    QVector<QString> texts;
+    QHash<quint64, QVector<int> > trigrams;
+    QVector<Word> words;
+    bool wordsSorted;
+    int dead;
+};
+
+#endif // CONNECTIONINDEX_H
@@ -0,0 +1,475 @@
+#include "connectionmodel.h"
+#include "connectiondata.h"
+#include "groupdata.h"
+
+#include <QPainter>
+#include <QPixmap>
+#include <QColor>
+
+#include <algorithm>
+
+ConnectionModel::ConnectionModel(QObject *parent) :
+    QAbstractItemModel(parent),
+    groupIcon(":/Icons/folder.png"),
+    connectionIcon(":/Icons/computer.png")
+{
+    root.Type = GroupItem;
+    root.Parent = 0;
+    root.Row = 0;
+    root.Status = StatusUnknown;
+
+    // The connection icon with a colored dot for each status
+    const QColor colors[4] = { QColor(), QColor(40, 170, 40), QColor(230, 150, 0), QColor(200, 30, 30) };
+
+    statusIcons[StatusUnknown] = connectionIcon;
+    for (int i = StatusUp ; i <= StatusDown ; i++)
+    {
+        QPixmap pixmap = connectionIcon.pixmap(16, 16);
+        QPainter p(&pixmap);
+        p.setRenderHint(QPainter::Antialiasing);
+        p.setPen(Qt::white);
+        p.setBrush(colors[i]);
+        p.drawEllipse(9, 9, 6, 6);
+        p.end();
+
+        statusIcons[i] = QIcon(pixmap);
+    }
+}
+
+ConnectionModel::~ConnectionModel()
+{
+    DeleteAll();
+}
+
+ConnectionModel::Item *ConnectionModel::ItemFor(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return const_cast<Item *>(&root);
+
+    return static_cast<Item *>(index.internalPointer());
+}
+
+QModelIndex ConnectionModel::index(int row, int column, const QModelIndex &parent) const
+{
+    Item *p = ItemFor(parent);
+
+    if (column != 0 || row < 0 || row >= p->Children.size())
+        return QModelIndex();
+
+    return createIndex(row, 0, p->Children.at(row));
+}
+
+QModelIndex ConnectionModel::parent(const QModelIndex &child) const
+{
+    if (!child.isValid())
+        return QModelIndex();
+
+    Item *p = ItemFor(child)->Parent;
+    if (p == 0 || p == &root)
+        return QModelIndex();
+
+    return createIndex(p->Row, 0, p);
+}
+
+int ConnectionModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.column() > 0)
+        return 0;
+
+    return ItemFor(parent)->Children.size();
+}
+
+int ConnectionModel::columnCount(const QModelIndex &) const
+{
+    return 1;
+}
+
+QVariant ConnectionModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid())
+        return QVariant();
+
+    Item *item = ItemFor(index);
+
+    switch (role)
+    {
+    case Qt::DisplayRole:
+    case Qt::EditRole:
+        if (item->Type == GroupItem)
+            return groups.value(item->Uuid)->Name;
+        return connections.value(item->Uuid)->Name;
+    case Qt::DecorationRole:
+        if (item->Type == GroupItem)
+            return groupIcon;
+        return statusIcons[item->Status];
+    case Qt::ForegroundRole:
+        if (item->Status == StatusDown)
+            return QColor(Qt::gray);
+        if (item->Status == StatusDegraded)
+            return QColor(180, 100, 0);
+        break;
+    case Qt::ToolTipRole:
+        if (item->Type == ConnectionItem)
+        {
+            ConnectionData *c = connections.value(item->Uuid);
+            QString status;
+            switch (item->Status)
+            {
+            case StatusUp:
+                status = "up";
+                break;
+            case StatusDegraded:
+                status = "not answering";
+                break;
+            case StatusDown:
+                status = "unreachable";
+                break;
+            default:
+                status = "not checked yet";
+            }
+            return QString("%1:%2, %3").arg(c->Host).arg(c->Port).arg(status);
+        }
+        break;
+    case UuidRole:
+        return QVariant(item->Uuid);
+    case TypeRole:
+        return QVariant(item->Type);
+    case StatusRole:
+        return QVariant(item->Status);
+    }
+
+    return QVariant();
+}
+
+bool ConnectionModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || role != Qt::EditRole)
+        return false;
+
+    Item *item = ItemFor(index);
+
+    if (item->Type == GroupItem)
+        groups.value(item->Uuid)->Name = value.toString();
+    else
+        connections.value(item->Uuid)->Name = value.toString();
+
+    emit dataChanged(index, index);
+    emit Renamed(item->Uuid);
+
+    return true;
+}
+
+Qt::ItemFlags ConnectionModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return Qt::NoItemFlags;
+
+    Qt::ItemFlags f = Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+
+    // Dynamic items are not editable
+    Item *item = ItemFor(index);
+    if (item->Type == GroupItem || !connections.value(item->Uuid)->Dynamic)
+        f |= Qt::ItemIsEditable;
+
+    return f;
+}
+
+GroupData *ConnectionModel::Group(QUuid uuid) const
+{
+    return groups.value(uuid);
+}
+
+ConnectionData *ConnectionModel::Connection(QUuid uuid) const
+{
+    return connections.value(uuid);
+}
+
+QList<GroupData *> ConnectionModel::Groups() const
+{
+    return groups.values();
+}
+
+QList<ConnectionData *> ConnectionModel::Connections() const
+{
+    return connections.values();
+}
+
+QList<ConnectionData *> ConnectionModel::Members(QUuid group) const
+{
+    QList<ConnectionData *> result;
+
+    Item *item = items.value(group);
+    if (item == 0 || item->Type != GroupItem)
+        return result;
+
+    foreach (Item *child, item->Children)
+        result.append(connections.value(child->Uuid));
+
+    return result;
+}
+
+QModelIndex ConnectionModel::IndexOf(QUuid uuid) const
+{
+    Item *item = items.value(uuid);
+    if (item == 0)
+        return QModelIndex();
+
+    return createIndex(item->Row, 0, item);
+}
+
+QUuid ConnectionModel::UuidOf(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return QUuid();
+
+    return ItemFor(index)->Uuid;
+}
+
+int ConnectionModel::TypeOf(const QModelIndex &index) const
+{
+    if (!index.isValid())
+        return -1;
+
+    return ItemFor(index)->Type;
+}
+
+ConnectionModel::Item *ConnectionModel::NewItem(QUuid uuid, int type, Item *parent)
+{
+    Item *item = new Item;
+    item->Uuid = uuid;
+    item->Type = type;
+    item->Parent = parent;
+    item->Row = parent->Children.size();
+    item->Status = StatusUnknown;
+
+    parent->Children.append(item);
+    items[uuid] = item;
+
+    return item;
+}
+
+// Free an item, its children and their records. Doesn't unlink it.
+void ConnectionModel::DeleteItem(Item *item)
+{
+    foreach (Item *child, item->Children)
+        DeleteItem(child);
+
+    items.remove(item->Uuid);
+
+    if (item->Type == GroupItem)
+        delete groups.take(item->Uuid);
+    else
+        delete connections.take(item->Uuid);
+
+    delete item;
+}
+
+void ConnectionModel::DeleteAll()
+{
+    foreach (Item *child, root.Children)
+        DeleteItem(child);
+
+    root.Children.clear();
+}
+
+// Replace everything in one go. Connections whose group is unknown
+// are dropped.
+void ConnectionModel::Load(QList<GroupData *> groupList, QList<ConnectionData *> connectionList)
+{
+    beginResetModel();
+
+    DeleteAll();
+
+    foreach (GroupData *grp, groupList)
+    {
+        groups[grp->Uuid] = grp;
+        NewItem(grp->Uuid, GroupItem, &root);
+    }
+
+    foreach (ConnectionData *c, connectionList)
+    {
+        Item *parent = &root;
+
+        if (!c->Group.isNull())
+        {
+            parent = items.value(c->Group);
+            if (parent == 0 || parent->Type != GroupItem)
+            {
+                delete c;
+                continue;
+            }
+        }
+
+        connections[c->Uuid] = c;
+        NewItem(c->Uuid, ConnectionItem, parent);
+    }
+
+    endResetModel();
+}
+
+void ConnectionModel::AddGroup(GroupData *grp)
+{
+    beginInsertRows(QModelIndex(), root.Children.size(), root.Children.size());
+
+    groups[grp->Uuid] = grp;
+    NewItem(grp->Uuid, GroupItem, &root);
+
+    endInsertRows();
+}
+
+// Add a connection below the group in its Group field, or at the top
+void ConnectionModel::AddConnection(ConnectionData *c)
+{
+    QList<ConnectionData *> list;
+    list.append(c);
+
+    AddConnections(c->Group, list);
+}
+
+// Add many connections to one group, announced as a single insert
+void ConnectionModel::AddConnections(QUuid group, QList<ConnectionData *> list)
+{
+    Item *parent = &root;
+    QModelIndex parentIndex;
+
+    if (!group.isNull())
+    {
+        parent = items.value(group);
+        if (parent == 0 || parent->Type != GroupItem)
+        {
+            qDeleteAll(list);
+            return;
+        }
+        parentIndex = IndexOf(group);
+    }
+
+    if (list.isEmpty())
+        return;
+
+    int first = parent->Children.size();
+    beginInsertRows(parentIndex, first, first + list.size() - 1);
+
+    parent->Children.reserve(first + list.size());
+    foreach (ConnectionData *c, list)
+    {
+        c->Group = group;
+        connections[c->Uuid] = c;
+        NewItem(c->Uuid, ConnectionItem, parent);
+    }
+
+    endInsertRows();
+}
+
+void ConnectionModel::Remove(QUuid uuid)
+{
+    Item *item = items.value(uuid);
+    if (item == 0)
+        return;
+
+    Item *parent = item->Parent;
+    int row = item->Row;
+
+    beginRemoveRows(parent == &root ? QModelIndex() : IndexOf(parent->Uuid), row, row);
+
+    parent->Children.remove(row);
+    for (int i = row ; i < parent->Children.size() ; i++)
+        parent->Children.at(i)->Row = i;
+
+    DeleteItem(item);
+
+    endRemoveRows();
+}
+
+// Remove many connections at once. Rows next to each other go in one
+// removal, from the bottom up so the rows above stay where they are,
+// and the rows that are left are numbered once at the end.
+void ConnectionModel::RemoveConnections(QList<QUuid> list)
+{
+    QHash<Item *, QVector<int> > rows;
+
+    foreach (QUuid uuid, list)
+    {
+        Item *item = items.value(uuid);
+        if (item && item->Type == ConnectionItem)
+            rows[item->Parent].append(item->Row);
+    }
+
+    for (QHash<Item *, QVector<int> >::iterator it = rows.begin() ; it != rows.end() ; ++it)
+    {
+        Item *parent = it.key();
+        QVector<int> &removed = it.value();
+        QModelIndex parentIndex = parent == &root ? QModelIndex() : IndexOf(parent->Uuid);
+
+        std::sort(removed.begin(), removed.end());
+        removed.erase(std::unique(removed.begin(), removed.end()), removed.end());
+
+        int last = removed.size() - 1;
+        while (last >= 0)
+        {
+            int first = last;
+            while (first > 0 && removed.at(first - 1) == removed.at(first) - 1)
+                first--;
+
+            int top = removed.at(first);
+            int count = last - first + 1;
+
+            beginRemoveRows(parentIndex, top, top + count - 1);
+
+            for (int i = top ; i < top + count ; i++)
+                DeleteItem(parent->Children.at(i));
+            parent->Children.remove(top, count);
+
+            // Groups have children that find their parent by its row,
+            // so at the top level the rows have to be right at once
+            if (parent == &root)
+            {
+                for (int i = top ; i < parent->Children.size() ; i++)
+                    parent->Children.at(i)->Row = i;
+            }
+
+            endRemoveRows();
+
+            last = first - 1;
+        }
+
+        for (int i = removed.first() ; i < parent->Children.size() ; i++)
+            parent->Children.at(i)->Row = i;
+    }
+}
+
+// Remove all members of a group, announced as a single removal
+void ConnectionModel::ClearGroup(QUuid group)
+{
+    Item *item = items.value(group);
+    if (item == 0 || item->Type != GroupItem || item->Children.isEmpty())
+        return;
+
+    beginRemoveRows(IndexOf(group), 0, item->Children.size() - 1);
+
+    foreach (Item *child, item->Children)
+        DeleteItem(child);
+    item->Children.clear();
+
+    endRemoveRows();
+}
+
+// A record was changed from outside
+void ConnectionModel::Changed(QUuid uuid)
+{
+    QModelIndex index = IndexOf(uuid);
+    if (index.isValid())
+        emit dataChanged(index, index);
+}
+
+// Status changes only touch the decoration, not the text
+void ConnectionModel::SetStatus(QUuid uuid, int status)
+{
+    Item *item = items.value(uuid);
+    if (item == 0 || item->Status == status)
+        return;
+
+    item->Status = status;
+
+    QModelIndex index = createIndex(item->Row, 0, item);
+    emit dataChanged(index, index, QVector<int>() << Qt::DecorationRole << Qt::ForegroundRole << Qt::ToolTipRole << StatusRole);
+}
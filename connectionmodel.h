@@ -0,0 +1,108 @@
+#ifndef CONNECTIONMODEL_H
+#define CONNECTIONMODEL_H
+
+#include <QAbstractItemModel>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QUuid>
+#include <QIcon>
+
+class ConnectionData;
+class GroupData;
+
+enum ItemType
+{
+    GroupItem,
+    ConnectionItem
+};
+
+// What the health prober last found out about a connection
+enum HostStatus
+{
+    StatusUnknown,
+    StatusUp,
+    StatusDegraded,
+    StatusDown
+};
+
+// Groups and connections as a two level tree. Groups and ungrouped
+// connections are at the top, connections of a group below it. All
+// records are found by UUID through hash tables, rows are kept in
+// insertion order and sorted by a proxy model for display.
+//
+// The model owns the group and connection records.
+class ConnectionModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    enum Roles
+    {
+        UuidRole = Qt::UserRole,
+        TypeRole = Qt::UserRole + 1,
+        StatusRole = Qt::UserRole + 2
+    };
+
+    explicit ConnectionModel(QObject *parent = 0);
+    ~ConnectionModel();
+
+    QModelIndex index(int row, int column, const QModelIndex &parent = QModelIndex()) const;
+    QModelIndex parent(const QModelIndex &child) const;
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+
+    GroupData *Group(QUuid uuid) const;
+    ConnectionData *Connection(QUuid uuid) const;
+    QList<GroupData *> Groups() const;
+    QList<ConnectionData *> Connections() const;
+    QList<ConnectionData *> Members(QUuid group) const;
+
+    QModelIndex IndexOf(QUuid uuid) const;
+    QUuid UuidOf(const QModelIndex &index) const;
+    int TypeOf(const QModelIndex &index) const;
+
+    void Load(QList<GroupData *> groupList, QList<ConnectionData *> connectionList);
+    void AddGroup(GroupData *grp);
+    void AddConnection(ConnectionData *c);
+    void AddConnections(QUuid group, QList<ConnectionData *> list);
+    void Remove(QUuid uuid);
+    void RemoveConnections(QList<QUuid> list);
+    void ClearGroup(QUuid group);
+    void Changed(QUuid uuid);
+
+public slots:
+    void SetStatus(QUuid uuid, int status);
+
+signals:
+    void Renamed(QUuid uuid);
+
+protected:
+    struct Item
+    {
+        QUuid Uuid;
+        int Type;
+        Item *Parent;
+        int Row;
+        int Status;
+        QVector<Item *> Children;
+    };
+
+    Item *ItemFor(const QModelIndex &index) const;
+    Item *NewItem(QUuid uuid, int type, Item *parent);
+    void DeleteItem(Item *item);
+    void DeleteAll();
+
+    Item root;
+    QHash<QUuid, Item *> items;
+    QHash<QUuid, GroupData *> groups;
+    QHash<QUuid, ConnectionData *> connections;
+    QIcon groupIcon;
+    QIcon connectionIcon;
+    QIcon statusIcons[4];
+};
+
+#endif // CONNECTIONMODEL_H
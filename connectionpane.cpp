@@ -13,7 +13,9 @@
 #include <QDomNode>
 #include <QDomNodeList>
 #include <QDomAttr>
-#include <QTextEdit>
+#include <QTextBrowser>
+#include <QTextDocument>
+#include <QTextCursor>
 #include <QLineEdit>
 #include <QLabel>
 #include <QVBoxLayout>
@@ -24,37 +26,130 @@
 #include <QDnsLookup>
 #include <QEventLoop>
 #include <QDebug>
-#include <QFontDatabase>
-#include <QSettings>
+#include <QKeyEvent>
+#include <QDateTime>
+#include <QScrollBar>
+#include <QRegularExpression>
+#include <QShowEvent>
+#include <QHideEvent>
 
 #include "connectiondata.h"
-
-struct CommandData
+#include "sessionmanager.h"
+#include "helptreecache.h"
+#include "commandhistory.h"
+#include "panetheme.h"
+#include "alertengine.h"
+#include "watchview.h"
+#include "metricextractor.h"
+#include "memorybudget.h"
+
+// Characters of HTML kept in the scrollback
+static const int MaxScrollback = 131400;
+
+// Lines a session keeps when the memory budget makes it drop its output
+static const int CompactLines = 256;
+
+// What the text document takes per paragraph beyond the text itself,
+// for the memory accounting
+static const int BlockOverhead = 256;
+
+// Only what doesn't depend on the connection is done here, so a pane
+// can be built ahead of time and reused for another connection.
+ConnectionPane::ConnectionPane(QWidget *parent) :
+    QWidget(parent),
+    themeGeneration(-1),
+    ui(new Ui::ConnectionPane)
 {
-public:
-    QString Module;
-    QString HelpText;
-    QString LongHelp;
-    QString Description;
-    ConnectionPane *instance;
-    void (*fn)(QString module, ConnectionPane *instance, QStringList args);
-};
+    ui->setupUi(this);
+
+    Port = 0;
+
+    loggedIn = false;
+    expectingInput = false;
+    expectingCommand = false;
+    lastActivity.start();
+    lastViewed.start();
+
+    historyCursor = 0;
+    historySearching = false;
+    historyMatch = 0;
+
+    foldSeq = 0;
+    foldCount = 0;
+    foldShown = 0;
+    counterText = -1;
+    counterDoc = 0;
+
+    completionTree = 0;
+    completionQuoted = false;
+    completionFirst = 0;
+    completionLast = 0;
+    completionIndex = -1;
+
+    // Completion hints are computed once typing pauses, not per keystroke
+    hintTimer = new QTimer(this);
+    hintTimer->setSingleShot(true);
+    hintTimer->setInterval(30);
+    connect(hintTimer, SIGNAL(timeout()), this, SLOT(UpdateHints()));
+
+    // Logging in again after a restart
+    loginTimer = new QTimer(this);
+    loginTimer->setSingleShot(true);
+    loginTimer->setInterval(5000);
+    connect(loginTimer, SIGNAL(timeout()), this, SLOT(Login()));
+
+    ui->textEntry->installEventFilter(this);
+
+    // Watched commands run on a timer and show in a view of their own
+    watchTimer = new QTimer(this);
+    connect(watchTimer, SIGNAL(timeout()), this, SLOT(WatchTick()));
+    watchCapturing = false;
+    watchPaused = false;
+    watchSent = false;
+
+    watchView = new WatchView(this);
+    watchView->hide();
+    ui->verticalLayout->insertWidget(1, watchView);
+
+    ui->mainPane->setOpenLinks(false);
+    connect(ui->mainPane, SIGNAL(anchorClicked(const QUrl &)), this, SLOT(ExpandFold(const QUrl &)));
+
+    // Output is only ever appended, an undo stack would keep all of it
+    ui->mainPane->document()->setUndoRedoEnabled(false);
+
+    tree = QSharedPointer<const CommandTree>(new CommandTree());
+
+    // Construct the manager
+    manager = new QNetworkAccessManager(this);
 
-Q_DECLARE_METATYPE (CommandData)
+    pollReply = 0;
+    loginReply = 0;
+    cmdReply = 0;
+
+    MemoryBudget::Instance()->Register(this);
+
+    ApplyTheme();
+}
 
 ConnectionPane::ConnectionPane(ConnectionData *c, QHostAddress addr, QWidget *parent) :
-    QWidget(parent),
-    ui(new Ui::ConnectionPane)
+    ConnectionPane(parent)
 {
-    ui->setupUi(this);
+    Setup(c, addr);
+}
 
+void ConnectionPane::Setup(ConnectionData *c, QHostAddress addr)
+{
     Name = c->Name;
     Host = c->Host;
     Port = c->Port;
     User = c->User;
     Pass = c->Pass;
 
-    loggedIn = false;
+    // History follows the server, whatever the host name resolves to
+    historyKey = Host + QString(":") + QString::number(Port);
+    historyCursor = CommandHistory::Instance()->End(historyKey);
+
+    lastActivity.restart();
 
     QDnsLookup lookup;
 
@@ -80,6 +175,7 @@ ConnectionPane::ConnectionPane(ConnectionData *c, QHostAddress addr, QWidget *pa
     }
 
     // Construct the URLs
+    urlStart = QUrl();
     urlStart.setScheme(QString("http"));
     urlStart.setHost(Host);
     urlStart.setPort(Port);
@@ -92,33 +188,94 @@ ConnectionPane::ConnectionPane(ConnectionData *c, QHostAddress addr, QWidget *pa
     urlClose.setPath(QString("/CloseSession/"));
     urlCommand.setPath(QString("/SessionCommand/"));
 
-    // Construct the manager
-    manager = new QNetworkAccessManager(this);
+    ApplyTheme();
+}
 
-    pollReply = 0;
-    loginReply = 0;
-    cmdReply = 0;
+// Put the pane back the way the constructor left it, ready for Setup()
+void ConnectionPane::Reset()
+{
+    CloseSession(QString());
+    loginTimer->stop();
+    hintTimer->stop();
+    StopWatch();
+    queuedCommand = QString();
 
-    int id = QFontDatabase::addApplicationFont(":/fonts/Consolas.ttf");
-    QString family = QFontDatabase::applicationFontFamilies(id).at(0);
+    if (loginReply)
+    {
+        disconnect(loginReply, 0, this, 0);
+        loginReply->abort();
+        loginReply->deleteLater();
+        loginReply = 0;
+    }
 
-    QSettings settings;
+    if (cmdReply)
+    {
+        disconnect(cmdReply, 0, this, 0);
+        cmdReply->abort();
+        cmdReply->deleteLater();
+        cmdReply = 0;
+    }
 
-    QString styleSheet;
+    disconnect(ui->textEntry, 0, this, 0);
+
+    Name = QString();
+    Host = QString();
+    Port = 0;
+    User = QString();
+    Pass = QString();
+    sessionID = QString();
+
+    tree = QSharedPointer<const CommandTree>(new CommandTree());
+
+    expectingInput = false;
+    expectingCommand = false;
+
+    historyKey = QString();
+    historyCursor = 0;
+    historyDraft = QString();
+    historySearching = false;
+    historyQuery = QString();
+    historyMatches.clear();
+    historyMatch = 0;
+
+    completionTree = 0;
+    completionQuoted = false;
+    completionFirst = 0;
+    completionLast = 0;
+    completionIndex = -1;
+
+    hintText = QString();
+    ui->helpArea->setText(QString());
+    ui->textEntry->clear();
+    ui->textEntry->setEnabled(true);
+    ui->textEntry->setPlaceholderText(QString());
+    ClearScrollback();
+
+    lines.Clear();
+    metrics.clear();
+    emit LinesAdded();
+}
 
-    if (!settings.value("system_font", false).toBool())
-        styleSheet += "font-family: " + family + ";";
-    if (settings.value("black_on_white", false).toBool())
-        styleSheet += "background-color: black; color: white;";
-    else
-        styleSheet += "background-color: #fcfcfc; color: black;";
-    styleSheet += "font-size: 18pt;";
+// The theme is shared by all panes, only apply it when it changed
+void ConnectionPane::ApplyTheme()
+{
+    const PaneTheme &theme = PaneTheme::Current();
+
+    if (themeGeneration == theme.Generation)
+        return;
+
+    ui->mainPane->setFont(theme.Font);
+    ui->mainPane->setPalette(theme.Palette);
 
-    ui->mainPane->setStyleSheet(styleSheet);
+    themeGeneration = theme.Generation;
 }
 
 ConnectionPane::~ConnectionPane()
 {
+    CloseSession(QString());
+    SessionManager::Instance()->Unregister(this);
+    MemoryBudget::Instance()->Unregister(this);
+
     QNetworkAccessManager *m = manager;
     manager = 0;
     delete m;
@@ -132,6 +289,26 @@ void ConnectionPane::CommandReply()
     cmdReply->deleteLater();
     cmdReply = 0;
 
+    // A command entered while a watched one ran goes out now, the same
+    // way as from the entry. If it cannot, it is put back in the entry.
+    if (!queuedCommand.isEmpty())
+    {
+        QString cmd = queuedCommand;
+        queuedCommand = QString();
+        watchSent = false;
+
+        if (!Dispatch(cmd) && ui->textEntry->text().isEmpty())
+            ui->textEntry->setText(cmd);
+        return;
+    }
+
+    // The user may be typing while a watched command runs
+    if (watchSent)
+    {
+        watchSent = false;
+        return;
+    }
+
     ui->textEntry->setText(QString(""));
     TextChanged("");
 }
@@ -140,14 +317,36 @@ void ConnectionPane::LoginReply()
 {
     QByteArray result = loginReply->readAll();
     loginReply->deleteLater();
+    loginReply = 0;
+
+    ui->textEntry->setEnabled(true);
 
     if (result.size() == 0)
     {
-        ui->mainPane->setHtml("<font color=\"#7f7f7f\">Connecting ...<br></font><font color=\"#ff0000\">Error!</font>");
+        AppendOutput(QString("<br><font color=\"#ff0000\">Error!</font>"));
         QMessageBox::critical(0, QString("Connection error"), QString("Connection to host failed"));
         return;
     }
 
+    // Simulators running the same build send the same help tree. If we
+    // have seen it before, share the existing tree and keep the DOM parse
+    // down to the few remaining elements.
+    QByteArray treeHash;
+    QSharedPointer<const CommandTree> cached;
+
+    int treeStart = result.indexOf("<HelpTree");
+    int treeEnd = result.lastIndexOf("</HelpTree>");
+    if (treeStart >= 0 && treeEnd > treeStart)
+    {
+        int treeLength = treeEnd + 11 - treeStart;
+
+        treeHash = HelpTreeCache::Hash(result.mid(treeStart, treeLength));
+        cached = HelpTreeCache::Instance()->Find(treeHash);
+
+        if (cached)
+            result.remove(treeStart, treeLength);
+    }
+
     QDomDocument doc;
     doc.setContent(result, false);
 
@@ -160,64 +359,93 @@ void ConnectionPane::LoginReply()
 
     urlPoll.setPath(QString("/ReadResponses/")+sessionID+QString("/"));
 
-    QDomNodeList helpL = root.elementsByTagName(QString("HelpTree"));
-    QDomNode helpNode = helpL.at(0);
+    AppendOutput(QString("<br><font color=\"#7f7f7f\">Connected</font>"));
 
-    ui->mainPane->setHtml(ui->mainPane->toHtml() + QString("<font color=\"#7f7f7f\">Connected</font>"));
-    tree.clear();
+    if (cached)
+    {
+        tree = cached;
+    }
+    else
+    {
+        QDomNodeList helpL = root.elementsByTagName(QString("HelpTree"));
+        QDomNode helpNode = helpL.at(0);
+
+        CommandTree *parsed = new CommandTree();
 
-    tree = ProcessTreeLevel(helpNode, tree);
+        ProcessTreeLevel(helpNode, QStringList(), parsed);
+        AddLocalCommands(parsed);
+        parsed->Finalize();
 
-    QMap<QString, QVariant> nextLevel;
-    if (tree.contains("help"))
-        nextLevel = tree["help"].toMap();
+        if (treeHash.isEmpty())
+            tree = QSharedPointer<const CommandTree>(parsed);
+        else
+            tree = HelpTreeCache::Instance()->Insert(treeHash, parsed);
+    }
+
+    // Construct the poll request
+    QString data = "";
+    QNetworkRequest request(urlPoll);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/x-www-form-urlencoded"));
+
+    // Start poll
+    pollReply = manager->post(request, data.toLatin1());
+    connect(pollReply, SIGNAL(finished()), this, SLOT(PollReply()));
+
+    ui->textEntry->setFocus();
+    TextChanged(QString(""));
 
+    // A restarted server logs in again
+    connect(ui->textEntry, SIGNAL(returnPressed()), this, SLOT(ReturnPressed()), Qt::UniqueConnection);
+    connect(ui->textEntry, SIGNAL(textChanged(QString)), this, SLOT(TextChanged(QString)), Qt::UniqueConnection);
+
+    loggedIn = true;
+    lastActivity.restart();
+    ui->textEntry->setPlaceholderText(QString());
+
+    SessionManager::Instance()->Register(this);
+}
+
+// The commands we handle ourselves. They are the same for every session
+// so they are part of the shared tree.
+void ConnectionPane::AddLocalCommands(CommandTree *into)
+{
     CommandData cmd;
     cmd.Module = "Local";
     cmd.HelpText = "help [<command>]";
     cmd.LongHelp = "Provide help for commands";
     cmd.Description = "Provide help for commands";
-    cmd.instance = this;
     cmd.fn = Help;
 
-    QVariant v;
-    v.setValue<CommandData>(cmd);
-    nextLevel[""] = v;
-
-    tree["help"] = nextLevel;
-
-    nextLevel.clear();
-    if (tree.contains("quit:"))
-        nextLevel = tree["quit"].toMap();
+    into->Insert(QStringList("help"), cmd);
 
     cmd.Module = "Local";
     cmd.HelpText = "quit";
     cmd.LongHelp = "Quit console session";
     cmd.Description = "Quit console session";
-    cmd.instance = this;
     cmd.fn = Quit;
 
-    v.setValue<CommandData>(cmd);
-    nextLevel[""] = v;
+    into->Insert(QStringList("quit"), cmd);
 
-    tree["quit"] = nextLevel;
-
-    // Construct the poll request
-    QString data = "";
-    QNetworkRequest request(urlPoll);
-    request.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/x-www-form-urlencoded"));
+    cmd.Module = "Local";
+    cmd.HelpText = "apropos <word> [<word> ...]";
+    cmd.LongHelp = "Search the help of all commands for the given words";
+    cmd.Description = "Search command help";
+    cmd.fn = Apropos;
 
-    // Start poll
-    pollReply = manager->post(request, data.toLatin1());
-    connect(pollReply, SIGNAL(finished()), this, SLOT(PollReply()));
+    into->Insert(QStringList("apropos"), cmd);
+}
 
-    ui->textEntry->setFocus();
-    TextChanged(QString(""));
+// Command handlers by index, used to store trees on disk
+QVector<CommandFn> ConnectionPane::Handlers()
+{
+    QVector<CommandFn> handlers;
 
-    connect(ui->textEntry, SIGNAL(returnPressed()), this, SLOT(ReturnPressed()));
-    connect(ui->textEntry, SIGNAL(textChanged(QString)), this, SLOT(TextChanged(QString)));
+    handlers.append(CommandHandler);
+    handlers.append(Help);
+    handlers.append(Quit);
+    handlers.append(Apropos);
 
-    loggedIn = true;
+    return handlers;
 }
 
 void ConnectionPane::PollReply()
@@ -225,15 +453,23 @@ void ConnectionPane::PollReply()
     if (manager == 0)
         return;
 
+    bool wasInput = expectingInput;
+    bool wasCommand = expectingCommand;
+
     QByteArray result = pollReply->readAll();
 
     //qDebug() << QString(result);
     pollReply->deleteLater();
+    pollReply = 0;
 
     QString fullText;
+    QStringList received;
 
     if (result.size() != 0)
     {
+        qint64 now = QDateTime::currentMSecsSinceEpoch();
+        const MetricExtractor &extractor = MetricExtractor::Current();
+
         QDomDocument doc;
         doc.setContent(result, false);
 
@@ -271,36 +507,100 @@ void ConnectionPane::PollReply()
                     input = true;
             }
 
+            if (prompt || command)
+            {
+                expectingInput = true;
+                if (command)
+                    expectingCommand = true;
+            }
+
             QString line = e.text();
+            quint64 seq = lines.NextSeq();
+
+            // The plain lines, for views other than this one
+            quint8 lineLevel = ConsoleLine::LevelOf(level);
+            foreach (QString l, line.trimmed().split('\n'))
+            {
+                lines.Append(l, lineLevel, now);
+                received.append(l);
+
+                QList<QPair<QString, float> > values = extractor.Extract(l);
+                for (int v = 0 ; v < values.size() ; v++)
+                    metrics[values.at(v).first].Add(now, values.at(v).second);
+            }
+
+            // Output of a watched command goes to the watch view, up to
+            // the prompt that ends it
+            if (watchCapturing)
+            {
+                if (prompt || command)
+                {
+                    watchCapturing = false;
+                    watchView->SetLines(watchOutput);
+                }
+                else if (!input)
+                {
+                    watchOutput += line.trimmed().split('\n');
+                }
+                continue;
+            }
+
+            // A line like the one before it only counts up. The line
+            // itself is still in the line buffer.
+            QString key;
+            if (!input && !prompt && !command && !line.trimmed().contains('\n'))
+                key = level + QString(" ") + FoldKey(line.trimmed());
+
+            if (!key.isEmpty() && key == foldKey)
+            {
+                foldCount++;
+                continue;
+            }
+
+            // The counter of the run that ends goes after its line
+            if (foldCount != foldShown)
+            {
+                AppendOutput(fullText);
+                fullText = QString();
+                WriteCounter();
+            }
+
+            foldKey = key;
+            foldSeq = seq;
+            foldCount = 1;
+            foldShown = 1;
+            counterText = -1;
 
             if (!input)
                 fullText += QString("<br>");
             fullText += FormatLine(line.trimmed(), level).replace("\n", "<br>");
             if (fullText.endsWith("<br>"))
                 fullText = fullText.mid(fullText.length() - 4);
-
-            if (prompt || command)
-            {
-                expectingInput = true;
-                if (command)
-                    expectingCommand = true;
-            }
         }
     }
 
-    textContent += fullText;
-    if (textContent.length() > 131400)
-        textContent = textContent.right(131400);
+    AppendOutput(fullText);
 
-    ui->mainPane->setHtml(textContent);
+    if (foldCount != foldShown)
+        WriteCounter();
 
-    ui->mainPane->moveCursor(QTextCursor::End);
-    ui->mainPane->ensureCursorVisible();
+    if (!received.isEmpty())
+    {
+        emit LinesAdded();
+        AlertEngine::Instance()->Scan(this, received);
+    }
 
     if (!loggedIn)
         return;
 
-    TextChanged(ui->textEntry->text());
+    // The hints only depend on the poll through what the prompt
+    // expects. Going through the keystroke timer would keep pushing
+    // them back while output streams in.
+    if (expectingInput != wasInput || expectingCommand != wasCommand)
+    {
+        hintTimer->stop();
+        UpdateHints();
+    }
 
     // Construct the poll request
     QString data = "";
@@ -312,17 +612,24 @@ void ConnectionPane::PollReply()
     connect(pollReply, SIGNAL(finished()), this, SLOT(PollReply()));
 }
 
-void ConnectionPane::TextChanged(QString text)
+// Called for every keystroke, so all this does is (re)start the hint
+// timer. A pending update for older text is simply superseded.
+void ConnectionPane::TextChanged(QString)
 {
-    if (!expectingInput)
-        ui->helpArea->hide();
-    else if (!expectingCommand)
-        ui->helpArea->hide();
-    else
-        ui->helpArea->show();
+    hintTimer->start();
+}
 
-    ui->mainPane->moveCursor(QTextCursor::End);
-    ui->mainPane->ensureCursorVisible();
+void ConnectionPane::UpdateHints()
+{
+    // The help area shows the search status instead
+    if (historySearching)
+        return;
+
+    QString text = ui->textEntry->text();
+
+    bool showHelp = expectingInput && expectingCommand;
+    if (ui->helpArea->isVisibleTo(this) != showHelp)
+        ui->helpArea->setVisible(showHelp);
 
     QStringList words = Parse(text);
 
@@ -330,46 +637,383 @@ void ConnectionPane::TextChanged(QString text)
 
     QStringList opts = FindNextOption(words, trailingSpace);
 
-    if (opts.size() == 0)
-    {
-        ui->helpArea->setText(QString(""));
-    }
-    else
+    QString output;
+
+    if (opts.size() != 0)
     {
         QString first = opts.at(0);
         if (first.indexOf(QString("Command help:")) == 0)
-            ui->helpArea->setText(first);
+            output = first;
         else if (text != "")
-        {
-            QString output;
-            output.sprintf("Options: %s", opts.join(" ").toLocal8Bit().data());
-            ui->helpArea->setText(output);
-        }
+            output = QString("Options: ") + opts.join(" ");
         else
-        {
-            QString output;
-            output.sprintf("Commands: %s", opts.join(" ").toLocal8Bit().data());
-            ui->helpArea->setText(output);
-        }
+            output = QString("Commands: ") + opts.join(" ");
+    }
+
+    // Setting the same text again would still relayout the label
+    if (output != hintText)
+    {
+        hintText = output;
+        ui->helpArea->setText(output);
     }
 }
 
 void ConnectionPane::ReturnPressed()
 {
+    lastActivity.restart();
+
+    // A closed session logs in again, the command stays in the entry
+    // to be sent once it is back
+    if (!loggedIn)
+    {
+        Reconnect();
+        return;
+    }
+
     // Construct the command
     QString cmd = ui->textEntry->text();
 
-    if ((!expectingCommand) && expectingInput)
+    if (cmd == "/watch" || cmd.startsWith("/watch "))
+    {
+        Watch(cmd.mid(6).trimmed());
+        ui->textEntry->setText(QString(""));
+        return;
+    }
+
+    // A watched command holds the session, this one waits for it
+    if (cmdReply && watchSent)
+    {
+        if (!queuedCommand.isEmpty())
+        {
+            AppendOutput(QString("<br>") + OutputLine("Busy, the previous command has not been sent yet", "error"));
+            return;
+        }
+
+        queuedCommand = cmd;
+        ui->textEntry->setText(QString(""));
+        TextChanged(ui->textEntry->text());
+        return;
+    }
+
+    if (Dispatch(cmd))
+    {
+      ui->textEntry->setText(QString(""));
+      TextChanged(ui->textEntry->text());
+    }
+}
+
+// At a command prompt the text is resolved against the help tree, which
+// expands unique prefixes and runs the command, local or on the server.
+// At an input prompt it goes out as typed. Returns false if nothing was
+// sent or run.
+bool ConnectionPane::Dispatch(QString cmd)
+{
+    // One command at a time
+    if (cmdReply || !loggedIn)
+        return false;
+
+    QStringList words;
+
+    if (expectingCommand)
+    {
+        words = Resolve(Parse(cmd));
+        if (words.isEmpty())
+            return false;
+    }
+    else if (expectingInput)
+    {
+        if (!SendCommand(cmd))
+            return false;
+        words = Parse(cmd);
+    }
+    else
+    {
+        return false;
+    }
+
+    RememberCommand(words);
+    return true;
+}
+
+// Only what was actually sent or run is history
+void ConnectionPane::RememberCommand(QStringList words)
+{
+    QStringList resolved(words);
+
+    // Quote arguments the way Parse expects, so the entry can be reused
+    for (int i = 0 ; i < resolved.size() ; i++)
+    {
+        if (resolved.at(i).contains(" "))
+            resolved[i] = QString("\"") + resolved.at(i) + QString("\"");
+    }
+    QString historyEntry = resolved.join(" ");
+
+    if (historyEntry != "")
+        CommandHistory::Instance()->Add(historyKey, historyEntry);
+
+    historyCursor = CommandHistory::Instance()->End(historyKey);
+    historyDraft = QString();
+}
+
+// Tab completes the command word under the cursor, Up/Down walk the
+// history of this server, Ctrl-R searches the history of all servers.
+bool ConnectionPane::eventFilter(QObject *obj, QEvent *event)
+{
+    if (obj != ui->textEntry || event->type() != QEvent::KeyPress)
+        return QWidget::eventFilter(obj, event);
+
+    QKeyEvent *key = static_cast<QKeyEvent *>(event);
+
+    if (historySearching)
+        return HistorySearchKey(key);
+
+    if (key->key() == Qt::Key_Tab && key->modifiers() == Qt::NoModifier)
+    {
+        CompleteWord();
+        return true;
+    }
+
+    CommandHistory *history = CommandHistory::Instance();
+
+    if (key->key() == Qt::Key_R && (key->modifiers() & Qt::ControlModifier))
+    {
+        historySearching = true;
+        historyQuery = QString();
+        historyMatches.clear();
+        historyMatch = 0;
+        historyDraft = ui->textEntry->text();
+
+        ShowHistorySearch();
+        return true;
+    }
+
+    if (key->key() == Qt::Key_Up)
+    {
+        if (historyCursor >= history->End(historyKey))
+            historyDraft = ui->textEntry->text();
+
+        QString cmd = history->Older(historyKey, &historyCursor);
+        if (!cmd.isNull())
+            ui->textEntry->setText(cmd);
+
+        return true;
+    }
+
+    if (key->key() == Qt::Key_Down)
+    {
+        if (historyCursor >= history->End(historyKey))
+            return true;
+
+        QString cmd = history->Newer(historyKey, &historyCursor);
+        if (cmd.isNull())
+            ui->textEntry->setText(historyDraft);
+        else
+            ui->textEntry->setText(cmd);
+
+        return true;
+    }
+
+    return QWidget::eventFilter(obj, event);
+}
+
+bool ConnectionPane::HistorySearchKey(QKeyEvent *key)
+{
+    bool ctrl = key->modifiers() & Qt::ControlModifier;
+
+    if (ctrl && key->key() == Qt::Key_R)
+    {
+        if (historyMatch + 1 < historyMatches.size())
+            historyMatch++;
+    }
+    else if (key->key() == Qt::Key_Escape || (ctrl && key->key() == Qt::Key_G))
+    {
+        EndHistorySearch(false);
+        return true;
+    }
+    else if (key->key() == Qt::Key_Return || key->key() == Qt::Key_Enter)
+    {
+        // Take the match into the entry line but don't run it yet
+        EndHistorySearch(true);
+        return true;
+    }
+    else if (key->key() == Qt::Key_Backspace)
+    {
+        historyQuery.chop(1);
+        historyMatches = CommandHistory::Instance()->Search(historyQuery);
+        historyMatch = 0;
+    }
+    else if (!ctrl && key->text() != "" && key->text().at(0).isPrint())
+    {
+        historyQuery += key->text();
+        historyMatches = CommandHistory::Instance()->Search(historyQuery);
+        historyMatch = 0;
+    }
+    else
+    {
+        // Anything else ends the search and then does what it normally does
+        EndHistorySearch(true);
+        return false;
+    }
+
+    ShowHistorySearch();
+    return true;
+}
+
+void ConnectionPane::ShowHistorySearch()
+{
+    QString status = QString("(reverse-i-search)'") + historyQuery + QString("': ");
+
+    if (historyMatch < historyMatches.size())
+    {
+        int id = historyMatches.at(historyMatch);
+
+        ui->textEntry->setText(CommandHistory::Instance()->Command(id));
+
+        status += QString("%1 of %2, used %3 times").arg(historyMatch + 1).arg(historyMatches.size()).arg(CommandHistory::Instance()->Frequency(id));
+    }
+    else if (historyQuery != "")
+    {
+        status += QString("no match");
+    }
+
+    ui->helpArea->show();
+    ui->helpArea->setText(status);
+    hintText = status;
+}
+
+void ConnectionPane::EndHistorySearch(bool accept)
+{
+    historySearching = false;
+
+    if (!accept || historyMatch >= historyMatches.size())
+        ui->textEntry->setText(historyDraft);
+
+    historyCursor = CommandHistory::Instance()->End(historyKey);
+    hintTimer->start();
+}
+
+// Complete to the longest prefix shared by all options. When that
+// doesn't add anything, repeated Tabs cycle through the options.
+void ConnectionPane::CompleteWord()
+{
+    QString line = ui->textEntry->text();
+
+    if (completionIndex >= 0 && line == completionText && completionTree == tree.data())
+    {
+        completionIndex = (completionIndex + 1) % (completionLast - completionFirst);
+        InsertCompletion(tree->Name(completionFirst + completionIndex), false);
+        return;
+    }
+
+    completionIndex = -1;
+    completionTree = tree.data();
+
+    int cursor = ui->textEntry->cursorPosition();
+    QString text = line.left(cursor);
+    completionRest = line.mid(cursor);
+
+    // Inside quotes the word runs from the opening quote, as in Parse
+    completionQuoted = (text.count(QChar('"')) % 2) == 1;
+
+    int tokenStart;
+    if (completionQuoted)
+        tokenStart = text.lastIndexOf(QChar('"')) + 1;
+    else
+        tokenStart = text.lastIndexOf(QChar(' ')) + 1;
+
+    QString token = text.mid(tokenStart);
+
+    completionBase = text.left(tokenStart);
+    if (completionQuoted)
+        completionBase.chop(1);
+
+    int node = WalkTree(Parse(completionBase));
+    if (node < 0)
+        return;
+
+    int first;
+    int last;
+    tree->PrefixRange(node, token, &first, &last);
+
+    if (first == last)
+        return;
+
+    if (last - first == 1)
+    {
+        InsertCompletion(tree->Name(first), true);
+        return;
+    }
+
+    // The options are sorted, so what the first and last have in common
+    // is common to all of them
+    QStringRef a = tree->NameRef(first);
+    QStringRef b = tree->NameRef(last - 1);
+
+    int common = 0;
+    while (common < a.size() && common < b.size() && a.at(common) == b.at(common))
+        common++;
+
+    if (common > token.size())
+    {
+        InsertCompletion(a.toString().left(common), false);
+        return;
+    }
+
+    completionFirst = first;
+    completionLast = last;
+    completionIndex = 0;
+
+    InsertCompletion(tree->Name(first), false);
+}
+
+void ConnectionPane::InsertCompletion(QString word, bool complete)
+{
+    bool quote = completionQuoted || word.contains(QChar(' '));
+
+    QString text = completionBase;
+    if (quote)
+        text += QString("\"");
+    text += word;
+
+    if (complete)
+    {
+        if (quote)
+            text += QString("\"");
+        text += QString(" ");
+    }
+
+    ui->textEntry->setText(text + completionRest);
+    ui->textEntry->setCursorPosition(text.size());
+
+    completionText = ui->textEntry->text();
+}
+
+// Follow complete words through the tree, allowing unique prefixes like
+// Resolve does. Returns -1 if a word is ambiguous or unknown.
+int ConnectionPane::WalkTree(QStringList words)
+{
+    int current = tree->Root();
+
+    for (int i = 0 ; i < words.size() ; i++)
     {
-        if (SendCommand(cmd))
+        int next = tree->Child(current, words.at(i));
+
+        if (next < 0)
         {
-          ui->textEntry->setText(QString(""));
-          TextChanged(ui->textEntry->text());
+            int first;
+            int last;
+            tree->PrefixRange(current, words.at(i), &first, &last);
+
+            if (last - first != 1)
+                return -1;
+
+            next = first;
         }
+
+        current = next;
     }
 
-    QStringList resolved = Resolve(Parse(cmd));
-    QString historyEntry = resolved.join(" ");
+    return current;
 }
 
 void ConnectionPane::Login()
@@ -387,19 +1031,66 @@ void ConnectionPane::Login()
 
     // Log in
 
-    ui->mainPane->setHtml(ui->mainPane->toHtml() + QString("<font color=\"#7f7f7f\">Connecting ...</font>"));
+    AppendOutput(QString("<br><font color=\"#7f7f7f\">Connecting ...</font>"));
     loginReply = manager->post(request, data.toLatin1());
     connect(loginReply, SIGNAL(finished()), this, SLOT(LoginReply()));
 }
 
+// Log in again after the session was closed. The entry is off until
+// the login is through.
+void ConnectionPane::Reconnect()
+{
+    if (loggedIn || loginReply || loginTimer->isActive())
+        return;
+
+    ui->textEntry->setEnabled(false);
+
+    Login();
+}
+
 void ConnectionPane::CloseConnection()
 {
+    CloseSession(QString());
+
     close();
 }
 
+// End the session on the simulator, not just on our side. The pane
+// stays around so it can be reconnected.
+void ConnectionPane::CloseSession(QString reason)
+{
+    if (!loggedIn)
+        return;
+
+    loggedIn = false;
+
+    SessionManager::Instance()->Unregister(this);
+    SessionManager::Instance()->CloseSession(urlClose, sessionID, Name);
+    sessionID = QString();
+
+    if (pollReply)
+    {
+        disconnect(pollReply, 0, this, 0);
+        pollReply->abort();
+        pollReply->deleteLater();
+        pollReply = 0;
+    }
+
+    if (reason != "")
+        AppendOutput(QString("<br><font color=\"#7f7f7f\">") + reason.toHtmlEscaped() + QString("</font>"));
+
+    ui->textEntry->setPlaceholderText(QString("Press Enter to reconnect"));
+}
+
 void ConnectionPane::ClearScrollback()
 {
+    textContent = QString("");
     ui->mainPane->setHtml(QString(""));
+
+    foldKey = QString();
+    foldCount = 0;
+    foldShown = 0;
+    counterText = -1;
 }
 
 void ConnectionPane::Copy()
@@ -414,12 +1105,16 @@ void ConnectionPane::RestartServer()
 
     SendCommand("quit");
 
-    ui->mainPane->setHtml(ui->mainPane->toHtml() + QString("<font color=\"#7f7f7f\">Disconnected</font>"));
-    pollReply->abort();
+    AppendOutput(QString("<br><font color=\"#7f7f7f\">Disconnected</font>"));
+    if (pollReply)
+        pollReply->abort();
 
+    // The simulator drops all its sessions when it shuts down
     loggedIn = false;
+    sessionID = QString();
+    SessionManager::Instance()->Unregister(this);
 
-    QTimer::singleShot(5000, this, SLOT(Login()));
+    loginTimer->start();
 }
 
 bool ConnectionPane::IsLoggedIn()
@@ -427,45 +1122,124 @@ bool ConnectionPane::IsLoggedIn()
     return loggedIn;
 }
 
+QString ConnectionPane::GetName()
+{
+    return Name;
+}
+
+// The plain output lines, for the views that show more than one session
+const LineBuffer &ConnectionPane::Lines()
+{
+    return lines;
+}
+
+const QMap<QString, TimeSeries> &ConnectionPane::Metrics()
+{
+    return metrics;
+}
+
+// Milliseconds since the user last did anything in this session. A
+// session on screen or running a watch is in use.
+qint64 ConnectionPane::IdleTime()
+{
+    if (isVisible() || watchTimer->isActive())
+        return 0;
+
+    return lastActivity.elapsed();
+}
+
+const CommandTree *ConnectionPane::HelpTree()
+{
+    return tree.data();
+}
+
+// How long since the pane was last on screen, 0 while it is
+qint64 ConnectionPane::SinceViewed()
+{
+    if (isVisible())
+        return 0;
+
+    return lastViewed.elapsed();
+}
+
+// The help tree is shared, it is accounted for by the caller
+SessionMemory ConnectionPane::Memory()
+{
+    QTextDocument *doc = ui->mainPane->document();
+
+    SessionMemory m;
+    m.Scrollback = textContent.capacity() * 2;
+    m.Document = qint64(doc->characterCount()) * 2 + qint64(doc->blockCount()) * BlockOverhead;
+    m.Lines = lines.Bytes();
+
+    foreach (const QString &line, watchOutput)
+        m.Lines += line.capacity() * 2;
+
+    return m;
+}
+
+// Give back memory for the budget. Level 1 keeps the newest quarter of
+// the output, level 2 only a note and the last few lines. Returns about
+// how many bytes were freed.
+qint64 ConnectionPane::Compact(int level)
+{
+    qint64 before = Memory().Own();
+
+    if (level >= 2)
+    {
+        ClearScrollback();
+        AppendOutput(QString("<font color=\"#7f7f7f\">Older output was dropped to save memory</font>"));
+        lines.Shrink(CompactLines);
+    }
+    else
+    {
+        TrimScrollback(textContent.length() / 4);
+        lines.Shrink(lines.Count() / 4);
+    }
+
+    textContent.squeeze();
+
+    qint64 after = Memory().Own();
+    if (after >= before)
+        return 0;
+
+    emit LinesAdded();
+
+    return before - after;
+}
+
 QStringList ConnectionPane::CollectHelp(QStringList helpParts)
 {
     QString originalHelpRequest = helpParts.join(" ");
 
     QStringList help;
 
-    QMap<QString, QVariant> dict = tree;
+    int node = tree->Root();
     while (helpParts.size() > 0)
     {
-        QString helpPart = helpParts.at(0);
-
-        if (!dict.contains(helpPart))
+        int next = tree->Child(node, helpParts.at(0));
+        if (next < 0)
             break;
 
-        QVariant val = dict[helpPart];
-        if (QString(val.typeName()) == QString("QVariantMap"))
-        {
-            dict = val.toMap();
-        }
+        node = next;
 
         helpParts.removeFirst();
-
     }
 
-    if (dict.contains(QString("")))
+    const CommandData *ci = tree->Command(node);
+    if (ci)
     {
-        QVariant v = dict[QString("")];
-        CommandData ci = v.value<CommandData>();
-
-        help.append(ci.HelpText);
-        help.append(ci.LongHelp);
-        // help.append(ci.Description);
+        help.append(ci->HelpText);
+        help.append(ci->LongHelp);
+        // help.append(ci->Description);
     }
     else
     {
         help.append(QString("No help is available for ") + originalHelpRequest);
     }
 
-    return help;}
+    return help;
+}
 
 QStringList ConnectionPane::Parse(QString text)
 {
@@ -499,40 +1273,34 @@ QStringList ConnectionPane::Parse(QString text)
 QStringList ConnectionPane::Resolve(QStringList cmd)
 {
     QStringList result(cmd);
-    int index = -1;
 
-    QMap<QString, QVariant> current = tree;
+    int current = tree->Root();
 
     for (int i = 0 ; i < cmd.size() ; i++)
     {
-        QString s = cmd.at(i);
-
-        index++;
+        const QString &s = cmd.at(i);
 
-        QStringList found;
+        int first;
+        int last;
 
-        for (QMap<QString, QVariant>::iterator it = current.begin() ; it != current.end() ; it++)
+        // An exact match wins over longer options sharing the prefix
+        int exact = tree->Child(current, s);
+        if (exact >= 0)
         {
-            QString opt = it.key();
-
-            if (opt == s)
-            {
-                found.clear();
-                found.append(opt);
-                break;
-            }
-            if (opt.indexOf(s) == 0)
-            {
-                found.append(opt);
-            }
+            first = exact;
+            last = exact + 1;
+        }
+        else
+        {
+            tree->PrefixRange(current, s, &first, &last);
         }
 
-        if (found.size() == 1)
+        if (last - first == 1)
         {
-            result[index] = found.at(0);
-            current = current[found.at(0)].toMap();
+            result[i] = tree->Name(first);
+            current = first;
         }
-        else if (found.size() > 0)
+        else if (last > first)
         {
             QStringList blank;
             return blank;
@@ -543,15 +1311,13 @@ QStringList ConnectionPane::Resolve(QStringList cmd)
         }
     }
 
-    if (current.contains(QString("")))
+    const CommandData *ci = tree->Command(current);
+    if (ci)
     {
-        QVariant v = current[QString("")];
-        CommandData ci = v.value<CommandData>();
-
-        if (!ci.fn)
+        if (!ci->fn)
             return QStringList();
 
-        (*ci.fn)(ci.Module, ci.instance, result);
+        (*ci->fn)(ci->Module, this, result);
 
         return result;
     }
@@ -561,40 +1327,42 @@ QStringList ConnectionPane::Resolve(QStringList cmd)
 
 QStringList ConnectionPane::FindNextOption(QStringList cmd, bool term)
 {
-    QMap<QString, QVariant> current = tree;
+    int current = tree->Root();
 
     int remaining = cmd.size();
 
     for (int i = 0 ; i < cmd.size() ; i++)
     {
-        QString s = cmd.at(i);
+        const QString &s = cmd.at(i);
 
         remaining--;
 
-        QStringList found;
+        int first;
+        int last;
 
-        for (QMap<QString, QVariant>::iterator it = current.begin() ; it != current.end() ; it++)
-        {
-            QString opt = it.key();
+        int exact = -1;
+        if (remaining > 0)
+            exact = tree->Child(current, s);
 
-            if (remaining > 0 && opt == s)
-            {
-                found.clear();
-                found.append(opt);
-                break;
-            }
-            if (opt.indexOf(s) == 0)
-            {
-                found.append(opt);
-            }
+        if (exact >= 0)
+        {
+            first = exact;
+            last = exact + 1;
+        }
+        else
+        {
+            tree->PrefixRange(current, s, &first, &last);
         }
 
-        if (found.size() == 1 && ((remaining != 0) || term))
+        if (last - first == 1 && ((remaining != 0) || term))
         {
-            current = current[found.at(0)].toMap();
+            current = first;
         }
-        else if (found.size() > 0)
+        else if (last > first)
         {
+            QStringList found;
+            for (int n = first ; n < last ; n++)
+                found.append(tree->Name(n));
             return found;
         }
         else
@@ -603,54 +1371,40 @@ QStringList ConnectionPane::FindNextOption(QStringList cmd, bool term)
         }
     }
 
-    if (current.size() > 1)
+    const CommandData *ci = tree->Command(current);
+    int firstChild = tree->FirstChild(current);
+    int childCount = tree->ChildCount(current);
+
+    if (childCount + (ci ? 1 : 0) > 1)
     {
         QStringList choices;
 
-        bool addcr = false;
-        for (QMap<QString, QVariant>::iterator it = current.begin() ; it != current.end() ; it++)
-        {
-            QString s = it.key();
-
-            if (s == QString(""))
-            {
-                QVariant v = current[""];
-                CommandData ci = v.value<CommandData>();
-                if (ci.fn)
-                    addcr = true;
+        for (int n = firstChild ; n < firstChild + childCount ; n++)
+            choices.append(tree->Name(n));
 
-            }
-            else
-                choices.append(s);
-        }
-        if (addcr)
+        if (ci && ci->fn)
             choices.append("<cr>");
 
         return choices;
     }
 
-    if (current.contains(QString("")))
+    if (ci)
     {
-        QVariant v = current[""];
-        CommandData ci = v.value<CommandData>();
-
         QStringList ch;
-        ch.append(QString("Command help: ") + ci.HelpText);
+        ch.append(QString("Command help: ") + ci->HelpText);
         return ch;
     }
 
-    QList<QString> kl = current.keys();
-    QStringList ksl(kl);
+    QStringList ksl;
+    for (int n = firstChild ; n < firstChild + childCount ; n++)
+        ksl.append(tree->Name(n));
 
     return ksl;
 }
 
 void ConnectionPane::Help(QString, ConnectionPane *instance, QStringList args)
 {
-    instance->ui->mainPane->setHtml(instance->ui->mainPane->toHtml()+instance->OutputLine(QString("# ") + args.join(" "), "command"));
-
-    instance->ui->mainPane->moveCursor(QTextCursor::End);
-    instance->ui->mainPane->ensureCursorVisible();
+    QString output = QString("<br>") + instance->OutputLine(QString("# ") + args.join(" "), "command");
 
     QStringList help;
     QStringList helpParts(args);
@@ -659,52 +1413,72 @@ void ConnectionPane::Help(QString, ConnectionPane *instance, QStringList args)
 
     instance->ui->textEntry->setText(QString(""));
     instance->ui->helpArea->setText(QString(""));
+    instance->hintText = QString("");
 
     if (helpParts.size() == 0)
-        help = instance->CollectHelp(help, instance->tree);
+        instance->CollectHelp(instance->tree->Root(), &help);
     else
         help = help + instance->CollectHelp(helpParts);
 
     for (int i = 0 ; i < help.size() ; i++)
-    {
-        instance->ui->mainPane->setHtml(instance->ui->mainPane->toHtml()+instance->OutputLine(help.at(i), "normal"));
-    }
-    instance->ui->mainPane->moveCursor(QTextCursor::End);
-    instance->ui->mainPane->ensureCursorVisible();
+        output += QString("<br>") + instance->OutputLine(help.at(i), "normal");
+
+    instance->AppendOutput(output);
 }
 
 void ConnectionPane::Quit(QString, ConnectionPane *instance, QStringList)
 {
-    instance->ui->mainPane->setHtml(instance->ui->mainPane->toHtml()+instance->OutputLine("# quit", "command"));
-    instance->ui->mainPane->setHtml(instance->ui->mainPane->toHtml()+instance->OutputLine("Use the toolbar button to close session", "error"));
-    instance->ui->mainPane->moveCursor(QTextCursor::End);
-    instance->ui->mainPane->ensureCursorVisible();
+    instance->AppendOutput(QString("<br>") + instance->OutputLine("# quit", "command") +
+                           QString("<br>") + instance->OutputLine("Use the toolbar button to close session", "error"));
 
     instance->ui->textEntry->setText(QString(""));
     instance->ui->helpArea->setText(QString(""));
+    instance->hintText = QString("");
 }
 
-QStringList ConnectionPane::CollectHelp(QStringList help, QMap<QString, QVariant> level)
+void ConnectionPane::CollectHelp(int node, QStringList *help)
 {
-    for (QMap<QString, QVariant>::iterator it = level.begin() ; it != level.end() ; it++)
+    const CommandData *cmd = tree->Command(node);
+    if (cmd)
     {
-        QString key = it.key();
-        QVariant val = it.value();
+        QString item = cmd->HelpText + QString(" - ") + cmd->LongHelp;
+        help->append(item);
+    }
 
-        if (QString(val.typeName()) == QString("QVariantMap"))
-        {
-            QMap<QString, QVariant> nextLevel = val.toMap();
-            help = CollectHelp(help, nextLevel);
-        }
-        else
-        {
-            CommandData cmd = val.value<CommandData>();
-            QString item = cmd.HelpText + QString(" - ") + cmd.LongHelp;
-            help.append(item);
-        }
+    int firstChild = tree->FirstChild(node);
+    for (int n = firstChild ; n < firstChild + tree->ChildCount(node) ; n++)
+        CollectHelp(n, help);
+}
+
+void ConnectionPane::Apropos(QString, ConnectionPane *instance, QStringList args)
+{
+    QString output = QString("<br>") + instance->OutputLine(QString("# ") + args.join(" "), "command");
+
+    QStringList words(args);
+    words.removeFirst();
+
+    instance->ui->textEntry->setText(QString(""));
+    instance->ui->helpArea->setText(QString(""));
+    instance->hintText = QString("");
+
+    if (words.isEmpty())
+    {
+        instance->AppendOutput(output + QString("<br>") + instance->OutputLine("Usage: apropos <word> [<word> ...]", "error"));
+        return;
     }
 
-    return help;
+    QList<int> found = instance->tree->Apropos(words.join(" "), 50);
+
+    if (found.isEmpty())
+        output += QString("<br>") + instance->OutputLine(QString("Nothing appropriate for ") + words.join(" "), "normal");
+
+    foreach (int id, found)
+    {
+        const CommandData *cmd = instance->tree->CommandAt(id);
+        output += QString("<br>") + instance->OutputLine(cmd->HelpText + QString(" - ") + cmd->Description, "normal");
+    }
+
+    instance->AppendOutput(output);
 }
 
 void ConnectionPane::CommandHandler(QString, ConnectionPane *instance, QStringList args)
@@ -783,6 +1557,282 @@ QString ConnectionPane::OutputLine(QString line, QString level)
     return ret;
 }
 
+// Add to the end of the scrollback. Output is appended to the document
+// as it is; the document is only rebuilt when the scrollback has to be
+// trimmed, and then a quarter of it goes at once so that doesn't happen
+// on every poll.
+void ConnectionPane::AppendOutput(QString html)
+{
+    if (html == "")
+        return;
+
+    // The counter is no longer at the end, repeats start a new run
+    if (counterText >= 0)
+    {
+        foldKey = QString();
+        counterText = -1;
+    }
+
+    textContent += html;
+
+    if (textContent.length() > MaxScrollback)
+    {
+        TrimScrollback((MaxScrollback * 3) / 4);
+    }
+    else
+    {
+        QTextCursor cursor(ui->mainPane->document());
+        cursor.movePosition(QTextCursor::End);
+        cursor.insertHtml(html);
+    }
+
+    ui->mainPane->moveCursor(QTextCursor::End);
+    ui->mainPane->ensureCursorVisible();
+}
+
+// Keep about the last keep characters of the scrollback and redraw it
+void ConnectionPane::TrimScrollback(int keep)
+{
+    int cut = textContent.length() - keep;
+    if (cut <= 0)
+        return;
+
+    // The counter of the current run goes, it is written again below
+    bool counter = counterText >= 0;
+    if (counter)
+    {
+        textContent.truncate(counterText);
+        counterText = -1;
+    }
+
+    // Don't start the scrollback in the middle of a line
+    int lineStart = textContent.indexOf(QString("<br>"), cut);
+    if (lineStart >= 0)
+        cut = lineStart;
+
+    textContent = textContent.mid(cut);
+    ui->mainPane->setHtml(textContent);
+
+    if (counter)
+        WriteCounter();
+}
+
+// Lines that only differ in numbers and UUIDs fold together
+QString ConnectionPane::FoldKey(QString line)
+{
+    static const QRegularExpression uuid("[0-9a-fA-F]{8}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{4}-[0-9a-fA-F]{12}");
+    static const QRegularExpression digits("\\d+");
+
+    return line.replace(uuid, QString("<uuid>")).replace(digits, QString("#"));
+}
+
+QString ConnectionPane::CounterHtml(quint64 seq, int count)
+{
+    return QString("&nbsp;<a href=\"fold:%1:%2\">&times;%2</a>").arg(seq).arg(count);
+}
+
+// Show the count of the current run after its line. The run's line is
+// the last one in the pane, so the counter is always at the very end.
+void ConnectionPane::WriteCounter()
+{
+    QTextDocument *doc = ui->mainPane->document();
+
+    if (counterText >= 0)
+    {
+        textContent.truncate(counterText);
+
+        QTextCursor cursor(doc);
+        cursor.setPosition(counterDoc);
+        cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+        cursor.removeSelectedText();
+    }
+
+    QString html = CounterHtml(foldSeq, foldCount);
+
+    counterText = textContent.length();
+    counterDoc = doc->characterCount() - 1;
+
+    textContent += html;
+
+    QTextCursor cursor(doc);
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertHtml(html);
+
+    foldShown = foldCount;
+}
+
+// Put the folded lines back in, from the line buffer
+void ConnectionPane::ExpandFold(const QUrl &url)
+{
+    QStringList parts = url.path().split(':');
+    if (url.scheme() != QString("fold") || parts.count() != 2)
+        return;
+
+    quint64 seq = parts[0].toULongLong();
+    int count = parts[1].toInt();
+
+    QString counter = CounterHtml(seq, count);
+    int at = textContent.indexOf(counter);
+    if (at < 0)
+        return;
+
+    QString html;
+    int missing = 0;
+
+    for (int k = 1 ; k < count ; k++)
+    {
+        int index = lines.IndexOf(seq + k);
+        if (index < 0)
+        {
+            missing++;
+            continue;
+        }
+
+        const ConsoleLine &line = lines.At(index);
+        html += QString("<br>") + FormatLine(line.Text, ConsoleLine::LevelName(line.Level));
+    }
+
+    if (missing)
+        html += QString("<br>(%1 lines no longer kept)").arg(missing);
+
+    textContent.replace(at, counter.size(), html);
+
+    // Repeats from now on start a new run
+    if (seq == foldSeq)
+    {
+        foldKey = QString();
+        counterText = -1;
+    }
+    else if (counterText > at)
+    {
+        counterText += html.size() - counter.size();
+    }
+
+    int scroll = ui->mainPane->verticalScrollBar()->value();
+    ui->mainPane->setHtml(textContent);
+    ui->mainPane->verticalScrollBar()->setValue(scroll);
+
+    // The live counter is still last, as a space, the sign and the count
+    if (counterText >= 0)
+        counterDoc = ui->mainPane->document()->characterCount() - 1 - (2 + QString::number(foldShown).size());
+}
+
+// /watch <seconds> <command> runs the command over and over, /watch on
+// its own stops it
+void ConnectionPane::Watch(QString args)
+{
+    QString echo = QString("<br>") + OutputLine(QString("# /watch ") + args, "command");
+
+    if (args.isEmpty() || args == QString("off"))
+    {
+        StopWatch();
+        AppendOutput(echo);
+        return;
+    }
+
+    int space = args.indexOf(' ');
+    int seconds = args.left(space).toInt();
+    QString cmd = args.mid(space + 1).trimmed();
+
+    if (space < 0 || seconds < 1 || cmd.isEmpty())
+    {
+        AppendOutput(echo + QString("<br>") + OutputLine("Usage: /watch <seconds> <command>", "error"));
+        return;
+    }
+
+    AppendOutput(echo);
+
+    watchCommand = cmd;
+    watchCapturing = false;
+    watchPaused = false;
+    watchView->Clear();
+    watchView->show();
+
+    watchTimer->setInterval(seconds * 1000);
+    watchTimer->start();
+    UpdateWatchTitle();
+
+    WatchTick();
+}
+
+void ConnectionPane::StopWatch()
+{
+    watchTimer->stop();
+    watchCommand = QString();
+    watchCapturing = false;
+    watchPaused = false;
+    watchSent = false;
+    watchOutput.clear();
+    watchView->Clear();
+    watchView->hide();
+}
+
+// Nobody is looking at a hidden tab, so it doesn't ask the simulator
+void ConnectionPane::WatchTick()
+{
+    if (!isVisible())
+    {
+        if (!watchPaused)
+        {
+            watchPaused = true;
+            UpdateWatchTitle();
+        }
+        return;
+    }
+
+    if (watchPaused)
+    {
+        watchPaused = false;
+        UpdateWatchTitle();
+    }
+
+    if (!loggedIn)
+        return;
+
+    // Output that never saw its prompt still counts
+    if (watchCapturing)
+        watchView->SetLines(watchOutput);
+
+    if (!SendCommand(watchCommand))
+        return;
+
+    watchOutput.clear();
+    watchCapturing = true;
+    watchSent = true;
+}
+
+void ConnectionPane::UpdateWatchTitle()
+{
+    QString title = QString("Every %1s: %2").arg(watchTimer->interval() / 1000).arg(watchCommand);
+    if (watchPaused)
+        title += QString(" (paused)");
+
+    watchView->SetTitle(title);
+}
+
+// A watch that paused while the tab was hidden catches up right away
+void ConnectionPane::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+
+    lastViewed.restart();
+
+    if (watchPaused && watchTimer->isActive())
+    {
+        WatchTick();
+        watchTimer->start();
+    }
+}
+
+void ConnectionPane::hideEvent(QHideEvent *event)
+{
+    QWidget::hideEvent(event);
+
+    // Idle from when it was last seen
+    lastViewed.restart();
+    lastActivity.restart();
+}
+
 QString ConnectionPane::GetColor(QString text)
 {
     QList<QString> colors;
@@ -824,7 +1874,7 @@ void ConnectionPane::DumpTree(QMap<QString, QVariant> level)
 
 bool ConnectionPane::SendCommand(QString cmd)
 {
-    if (cmdReply)
+    if (cmdReply || !loggedIn)
         return false;
 
     QUrlQuery queryString;
@@ -843,7 +1893,7 @@ bool ConnectionPane::SendCommand(QString cmd)
     return true;
 }
 
-QMap<QString, QVariant> ConnectionPane::ProcessTreeLevel(QDomNode node, QMap<QString, QVariant> level)
+void ConnectionPane::ProcessTreeLevel(QDomNode node, QStringList path, CommandTree *into)
 {
     QDomNodeList levelL = node.childNodes();
     for (int i = 0 ; i < levelL.count() ; i++)
@@ -858,8 +1908,11 @@ QMap<QString, QVariant> ConnectionPane::ProcessTreeLevel(QDomNode node, QMap<QSt
                 QDomAttr att = a.toAttr();
                 QString name = att.value();
 
-                QMap<QString, QVariant> nextLevel;
-                level[name] = ProcessTreeLevel(n, nextLevel);
+                QStringList nextLevel(path);
+                nextLevel.append(name);
+
+                into->InsertLevel(nextLevel);
+                ProcessTreeLevel(n, nextLevel, into);
             }
             else if (e.tagName() == QString("Command"))
             {
@@ -881,12 +1934,9 @@ QMap<QString, QVariant> ConnectionPane::ProcessTreeLevel(QDomNode node, QMap<QSt
                         cmd.Description = cmdE.text();
                 }
                 cmd.fn = CommandHandler;
-                cmd.instance = this;
 
-                level[QString("")].setValue(cmd);
+                into->Insert(path, cmd);
             }
         }
     }
-
-    return level;
 }
@@ -2,15 +2,24 @@
 #define CONNECTIONPANE_H
 
 #include <QWidget>
-#include <QMap>
 #include <QUrl>
-#include <QVariant>
 #include <QDomNode>
 #include <QHostAddress>
+#include <QElapsedTimer>
+#include <QSharedPointer>
+#include <QMap>
+
+#include "commandtree.h"
+#include "linebuffer.h"
+#include "timeseries.h"
+#include "memorybudget.h"
 
 class QNetworkAccessManager;
 class QNetworkReply;
+class QTimer;
+class QKeyEvent;
 class ConnectionData;
+class WatchView;
 
 namespace Ui {
 class ConnectionPane;
@@ -21,37 +30,79 @@ class ConnectionPane : public QWidget
     Q_OBJECT
 
 public:
-    explicit ConnectionPane(ConnectionData *c, QHostAddress addr, QWidget *parent = 0);
+    explicit ConnectionPane(QWidget *parent = 0);
+    ConnectionPane(ConnectionData *c, QHostAddress addr, QWidget *parent = 0);
     ~ConnectionPane();
+signals:
+    void LinesAdded();
 public slots:
     void CommandReply();
     void LoginReply();
     void PollReply();
     void TextChanged(QString text);
+    void UpdateHints();
     void ReturnPressed();
     void Login();
+    void Reconnect();
+    void ExpandFold(const QUrl &url);
+    void WatchTick();
 public:
+    void Setup(ConnectionData *c, QHostAddress addr);
+    void Reset();
+    void ApplyTheme();
     void CloseConnection();
+    void CloseSession(QString reason);
     void ClearScrollback();
     void Copy();
     void RestartServer();
     bool IsLoggedIn();
+    QString GetName();
+    qint64 IdleTime();
+    const LineBuffer &Lines();
+    const QMap<QString, TimeSeries> &Metrics();
+    const CommandTree *HelpTree();
+    SessionMemory Memory();
+    qint64 Compact(int level);
+    qint64 SinceViewed();
+
+    static QVector<CommandFn> Handlers();
 
 protected:
+    bool eventFilter(QObject *obj, QEvent *event);
+    void showEvent(QShowEvent *event);
+    void hideEvent(QHideEvent *event);
+    void Watch(QString args);
+    void StopWatch();
+    void UpdateWatchTitle();
+    bool HistorySearchKey(QKeyEvent *key);
+    void ShowHistorySearch();
+    void EndHistorySearch(bool accept);
+    void CompleteWord();
+    void InsertCompletion(QString word, bool complete);
+    int WalkTree(QStringList words);
     QStringList CollectHelp(QStringList helpParts);
     QStringList Parse(QString text);
     QStringList Resolve(QStringList cmd);
     QStringList FindNextOption(QStringList cmd, bool term);
     static void Help(QString module, ConnectionPane *instance, QStringList args);
     static void Quit(QString module, ConnectionPane *instance, QStringList args);
-    QStringList CollectHelp(QStringList help, QMap<QString, QVariant> level);
+    static void Apropos(QString module, ConnectionPane *instance, QStringList args);
+    void CollectHelp(int node, QStringList *help);
     static void CommandHandler(QString module, ConnectionPane *instance, QStringList args);
     QString FormatLine(QString line, QString level);
     QString OutputLine(QString line, QString level);
+    void AppendOutput(QString html);
+    void TrimScrollback(int keep);
+    void WriteCounter();
+    static QString FoldKey(QString line);
+    static QString CounterHtml(quint64 seq, int count);
     QString GetColor(QString text);
     //void DumpTree(QMap<QString, QVariant> level);
     bool SendCommand(QString cmd);
-    QMap<QString, QVariant> ProcessTreeLevel(QDomNode node, QMap<QString, QVariant> level);
+    bool Dispatch(QString cmd);
+    void RememberCommand(QStringList words);
+    void ProcessTreeLevel(QDomNode node, QStringList path, CommandTree *into);
+    static void AddLocalCommands(CommandTree *into);
     QString Name;
     QString Host;
     int Port;
@@ -63,14 +114,51 @@ protected:
     QUrl urlPoll;
     QString sessionID;
     QNetworkAccessManager *manager;
-    QMap<QString, QVariant> tree;
+    QSharedPointer<const CommandTree> tree;
     QNetworkReply *loginReply;
     QNetworkReply *pollReply;
     QNetworkReply *cmdReply;
     bool loggedIn;
     QString textContent;
+    LineBuffer lines;
+    QMap<QString, TimeSeries> metrics;
+    QString foldKey;
+    quint64 foldSeq;
+    int foldCount;
+    int foldShown;
+    int counterText;
+    int counterDoc;
+    QTimer *watchTimer;
+    WatchView *watchView;
+    QString watchCommand;
+    QStringList watchOutput;
+    bool watchCapturing;
+    bool watchPaused;
+    bool watchSent;
+    QString queuedCommand;
     bool expectingInput;
     bool expectingCommand;
+    QElapsedTimer lastActivity;
+    QElapsedTimer lastViewed;
+    QTimer *hintTimer;
+    QTimer *loginTimer;
+    int themeGeneration;
+    QString hintText;
+    QString historyKey;
+    int historyCursor;
+    QString historyDraft;
+    bool historySearching;
+    QString historyQuery;
+    QList<int> historyMatches;
+    int historyMatch;
+    const CommandTree *completionTree;
+    QString completionBase;
+    QString completionRest;
+    QString completionText;
+    bool completionQuoted;
+    int completionFirst;
+    int completionLast;
+    int completionIndex;
 
 private:
     Ui::ConnectionPane *ui;
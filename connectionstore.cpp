@@ -0,0 +1,777 @@
+#include "connectionstore.h"
+
+#include <QSettings>
+#include <QStringList>
+#include <QStandardPaths>
+#include <QDataStream>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QTimer>
+#include <QFutureWatcher>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QDebug>
+
+// Bump the version whenever a record gains or loses a field, and keep
+// reading the older ones. Version 2 added the group refresh interval,
+// version 3 the scheduled jobs.
+static const quint32 StoreMagic = 0x43435331;
+static const quint32 JournalMagic = 0x43434a31;
+static const quint32 StoreVersion = 3;
+
+// The least a group and a connection take up as written by WriteGroup()
+// and WriteConnection()
+static const int GroupBytes = 16 + 4 + 4 + 1 + 4 + 4 + 4 + 1;
+static const int ConnectionBytes = 16 + 4 + 16 + 4 + 4 + 4 + 4;
+
+enum JournalOp
+{
+    JournalGroup = 1,
+    JournalConnection = 2,
+    JournalRemoved = 3,
+    JournalJob = 4
+};
+
+ConnectionStore::ConnectionStore(QObject *parent) :
+    QObject(parent),
+    readOnly(false)
+{
+    // Coalesce bursts of edits into one write
+    saveTimer = new QTimer(this);
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(500);
+    connect(saveTimer, SIGNAL(timeout()), this, SLOT(Save()));
+
+    writer = new QFutureWatcher<void>(this);
+    connect(writer, SIGNAL(finished()), this, SLOT(Saved()));
+}
+
+ConnectionStore::~ConnectionStore()
+{
+    writer->waitForFinished();
+}
+
+QString ConnectionStore::FileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QString("/connections.dat");
+}
+
+QString ConnectionStore::JournalName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + QString("/connections.journal");
+}
+
+// Older versions kept the records in QSettings under their UUID,
+// without the braces
+QString ConnectionStore::Key(QUuid uuid)
+{
+    return uuid.toString().mid(1, 36);
+}
+
+void ConnectionStore::WriteGroup(QDataStream &out, const GroupData &grp)
+{
+    out << grp.Uuid << grp.Name << (grp.Dns.isNull() ? QString() : grp.Dns.toString())
+        << grp.Dynamic << grp.Source << grp.User << grp.Pass << grp.Expanded
+        << qint32(grp.RefreshInterval);
+}
+
+void ConnectionStore::WriteConnection(QDataStream &out, const ConnectionData &c)
+{
+    out << c.Uuid << c.Name << c.Group << c.Host << qint32(c.Port) << c.User << c.Pass;
+}
+
+void ConnectionStore::WriteJob(QDataStream &out, const JobData &job)
+{
+    out << job.Uuid << job.Name << job.Command << qint32(job.Interval) << job.Target << job.Enabled;
+}
+
+bool ConnectionStore::ReadJob(QDataStream &in, JobData *job)
+{
+    qint32 interval;
+
+    in >> job->Uuid >> job->Name >> job->Command >> interval >> job->Target >> job->Enabled;
+
+    job->Interval = interval;
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool ConnectionStore::ReadGroup(QDataStream &in, GroupData *grp, quint32 version)
+{
+    QString dns;
+
+    in >> grp->Uuid >> grp->Name >> dns >> grp->Dynamic >> grp->Source
+       >> grp->User >> grp->Pass >> grp->Expanded;
+
+    if (version >= 2)
+    {
+        qint32 interval;
+        in >> interval;
+        grp->RefreshInterval = interval;
+    }
+
+    if (!dns.isEmpty())
+        grp->Dns = QHostAddress(dns);
+
+    return in.status() == QDataStream::Ok;
+}
+
+bool ConnectionStore::ReadConnection(QDataStream &in, ConnectionData *c)
+{
+    qint32 port;
+
+    in >> c->Uuid >> c->Name >> c->Group >> c->Host >> port >> c->User >> c->Pass;
+
+    c->Port = port;
+    c->Dynamic = false;
+
+    return in.status() == QDataStream::Ok;
+}
+
+void ConnectionStore::Load(QList<GroupData *> *groups, QList<ConnectionData *> *connections, QList<JobData *> *jobs)
+{
+    QHash<QUuid, GroupData *> groupMap;
+    QHash<QUuid, ConnectionData *> connectionMap;
+    QHash<QUuid, JobData *> jobMap;
+
+    Batch batch;
+
+    SnapshotState state = ReadSnapshot(&groupMap, &connectionMap, &jobMap);
+    if (state == SnapshotMissing)
+        batch.Migrated = LoadSettings(&groupMap, &connectionMap);
+
+    // Show what could be read, but keep the files as they are
+    int changes = 0;
+    if (state == SnapshotUnreadable)
+        readOnly = true;
+    else
+        changes = ReadJournal(&groupMap, &connectionMap, &jobMap);
+
+    if (changes < 0)
+        readOnly = true;
+
+    *groups = groupMap.values();
+    *connections = connectionMap.values();
+    *jobs = jobMap.values();
+
+    if (readOnly)
+    {
+        qWarning() << "Connection store left unchanged, changes will not be saved";
+        return;
+    }
+
+    // An empty journal may still be from an older version
+    if (!batch.Migrated && changes == 0 && !QFile::exists(JournalName()))
+        return;
+
+    // Fold the journal, or the old settings, into a new snapshot
+    batch.Snapshot = true;
+    foreach (GroupData *grp, *groups)
+        batch.Groups.append(*grp);
+    foreach (ConnectionData *c, *connections)
+        batch.Connections.append(*c);
+    foreach (JobData *job, *jobs)
+        batch.Jobs.append(*job);
+
+    writer->setFuture(QtConcurrent::run(&ConnectionStore::Write, batch));
+}
+
+// Read the snapshot in one go. Records read before a damaged one are
+// kept, but the snapshot is reported as unreadable.
+ConnectionStore::SnapshotState ConnectionStore::ReadSnapshot(QHash<QUuid, GroupData *> *groups, QHash<QUuid, ConnectionData *> *connections, QHash<QUuid, JobData *> *jobs)
+{
+    QFile f(FileName());
+    if (!f.open(QIODevice::ReadOnly))
+        return f.exists() ? SnapshotUnreadable : SnapshotMissing;
+
+    QByteArray data = f.readAll();
+    f.close();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic;
+    quint32 version;
+    quint32 groupCount;
+    quint32 connectionCount;
+
+    in >> magic >> version;
+    if (magic != StoreMagic || version < 1 || version > StoreVersion)
+    {
+        qWarning() << "Connection store" << FileName() << "has an unknown format";
+        return SnapshotUnreadable;
+    }
+
+    // Counts come from the file, don't let them ask for more than the
+    // rest of it could hold
+    in >> groupCount;
+    if (in.status() != QDataStream::Ok || qint64(groupCount) * GroupBytes > in.device()->bytesAvailable())
+    {
+        qWarning() << "Connection store" << FileName() << "is damaged";
+        return SnapshotUnreadable;
+    }
+
+    groups->reserve(groupCount);
+    for (quint32 i = 0 ; i < groupCount ; i++)
+    {
+        GroupData *grp = new GroupData();
+        if (!ReadGroup(in, grp, version))
+        {
+            qWarning() << "Connection store" << FileName() << "is damaged";
+            delete grp;
+            return SnapshotUnreadable;
+        }
+        groups->insert(grp->Uuid, grp);
+    }
+
+    in >> connectionCount;
+    if (in.status() != QDataStream::Ok || qint64(connectionCount) * ConnectionBytes > in.device()->bytesAvailable())
+    {
+        qWarning() << "Connection store" << FileName() << "is damaged";
+        return SnapshotUnreadable;
+    }
+
+    connections->reserve(connectionCount);
+    for (quint32 i = 0 ; i < connectionCount ; i++)
+    {
+        ConnectionData *c = new ConnectionData;
+        if (!ReadConnection(in, c))
+        {
+            qWarning() << "Connection store" << FileName() << "is damaged";
+            delete c;
+            return SnapshotUnreadable;
+        }
+        connections->insert(c->Uuid, c);
+    }
+
+    if (version < 3)
+        return SnapshotRead;
+
+    quint32 jobCount;
+
+    in >> jobCount;
+    if (in.status() != QDataStream::Ok)
+    {
+        qWarning() << "Connection store" << FileName() << "is damaged";
+        return SnapshotUnreadable;
+    }
+
+    for (quint32 i = 0 ; i < jobCount ; i++)
+    {
+        JobData *job = new JobData();
+        if (!ReadJob(in, job))
+        {
+            qWarning() << "Connection store" << FileName() << "is damaged";
+            delete job;
+            return SnapshotUnreadable;
+        }
+        jobs->insert(job->Uuid, job);
+    }
+
+    return SnapshotRead;
+}
+
+// Replay the changes made since the snapshot was written. A record cut
+// short by a crash ends the replay. Returns the number of changes, or
+// -1 if the journal has an unknown format.
+int ConnectionStore::ReadJournal(QHash<QUuid, GroupData *> *groups, QHash<QUuid, ConnectionData *> *connections, QHash<QUuid, JobData *> *jobs)
+{
+    QFile f(JournalName());
+    if (!f.open(QIODevice::ReadOnly))
+        return f.exists() ? -1 : 0;
+
+    QByteArray data = f.readAll();
+    f.close();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic;
+    quint32 version;
+
+    // Cut short before the header, there is nothing to replay
+    if (data.size() < 8)
+        return 0;
+
+    in >> magic >> version;
+    if (magic != JournalMagic || version < 1 || version > StoreVersion)
+    {
+        qWarning() << "Connection journal" << JournalName() << "has an unknown format";
+        return -1;
+    }
+
+    int changes = 0;
+
+    while (!in.atEnd())
+    {
+        quint8 op;
+        in >> op;
+
+        if (op == JournalGroup)
+        {
+            GroupData *grp = new GroupData();
+            if (!ReadGroup(in, grp, version))
+            {
+                delete grp;
+                break;
+            }
+            delete groups->value(grp->Uuid);
+            groups->insert(grp->Uuid, grp);
+        }
+        else if (op == JournalConnection)
+        {
+            ConnectionData *c = new ConnectionData;
+            if (!ReadConnection(in, c))
+            {
+                delete c;
+                break;
+            }
+            delete connections->value(c->Uuid);
+            connections->insert(c->Uuid, c);
+        }
+        else if (op == JournalJob)
+        {
+            JobData *job = new JobData();
+            if (!ReadJob(in, job))
+            {
+                delete job;
+                break;
+            }
+            delete jobs->value(job->Uuid);
+            jobs->insert(job->Uuid, job);
+        }
+        else if (op == JournalRemoved)
+        {
+            QUuid uuid;
+            in >> uuid;
+            if (in.status() != QDataStream::Ok)
+                break;
+            delete groups->take(uuid);
+            delete connections->take(uuid);
+            delete jobs->take(uuid);
+        }
+        else
+        {
+            break;
+        }
+
+        changes++;
+    }
+
+    if (!in.atEnd())
+        qWarning() << "Connection journal" << JournalName() << "is truncated, ignoring the rest of it";
+
+    return changes;
+}
+
+// Pick up the list from QSettings, as kept by older versions. Returns
+// true if there was anything to take over.
+bool ConnectionStore::LoadSettings(QHash<QUuid, GroupData *> *groups, QHash<QUuid, ConnectionData *> *connections)
+{
+    QSettings settings;
+
+    // The oldest versions kept the records in arrays
+    if (settings.contains("Groups/size") || settings.contains("Connections/size"))
+    {
+        Migrate(groups, connections);
+        return true;
+    }
+
+    if (!settings.childGroups().contains("Groups") && !settings.childGroups().contains("Connections"))
+        return false;
+
+    settings.beginGroup("Groups");
+    foreach (QString key, settings.childGroups())
+    {
+        settings.beginGroup(key);
+
+        GroupData *grp = new GroupData();
+
+        grp->Uuid = QUuid(QString("{%1}").arg(key));
+        grp->Name = settings.value("Name").toString();
+        grp->Dynamic = settings.value("Dynamic", QVariant(false)).toBool();
+        grp->Source = settings.value("Source", QVariant("")).toString();
+        grp->User = settings.value("User", QVariant("")).toString();
+        grp->Pass = settings.value("Pass", QVariant("")).toString();
+        grp->Expanded = settings.value("Expanded", QVariant(false)).toBool();
+
+        QVariant dnsAddress = settings.value("Dns");
+        if (dnsAddress.isValid())
+            grp->Dns = QHostAddress(dnsAddress.toString());
+
+        groups->insert(grp->Uuid, grp);
+
+        settings.endGroup();
+    }
+    settings.endGroup();
+
+    settings.beginGroup("Connections");
+    foreach (QString key, settings.childGroups())
+    {
+        settings.beginGroup(key);
+
+        ConnectionData *c = new ConnectionData;
+
+        c->Uuid = QUuid(QString("{%1}").arg(key));
+        c->Name = settings.value("Name").toString();
+        c->Host = settings.value("Host").toString();
+        c->Port = settings.value("Port").toInt();
+        c->User = settings.value("User").toString();
+        c->Pass = settings.value("Pass").toString();
+        c->Group = settings.value("Parent").toUuid();
+        c->Dynamic = false;
+
+        connections->insert(c->Uuid, c);
+
+        settings.endGroup();
+    }
+    settings.endGroup();
+
+    return true;
+}
+
+// Read the old array layout
+void ConnectionStore::Migrate(QHash<QUuid, GroupData *> *groups, QHash<QUuid, ConnectionData *> *connections)
+{
+    QSettings settings;
+
+    int groupCount = settings.beginReadArray(QString("Groups"));
+    for (int i = 0 ; i < groupCount ; i++)
+    {
+        settings.setArrayIndex(i);
+
+        GroupData *grp = new GroupData();
+
+        grp->Name = settings.value("Name").toString();
+        grp->Uuid = settings.value("Uuid").toUuid();
+        grp->Dynamic = settings.value("Dynamic", QVariant(false)).toBool();
+        grp->Source = settings.value("Source", QVariant("")).toString();
+        grp->User = settings.value("User", QVariant("")).toString();
+        grp->Pass = settings.value("Pass", QVariant("")).toString();
+        grp->Expanded = settings.value("Expanded", QVariant(false)).toBool();
+
+        QVariant dnsAddress = settings.value("Dns");
+        if (dnsAddress.isValid())
+            grp->Dns = QHostAddress(dnsAddress.toString());
+
+        groups->insert(grp->Uuid, grp);
+    }
+    settings.endArray();
+
+    int connCount = settings.beginReadArray(QString("Connections"));
+    for (int i = 0 ; i < connCount ; i++)
+    {
+        settings.setArrayIndex(i);
+
+        ConnectionData *c = new ConnectionData;
+
+        c->Name = settings.value("Name").toString();
+        c->Host = settings.value("Host").toString();
+        c->Port = settings.value("Port").toInt();
+        c->User = settings.value("User").toString();
+        c->Pass = settings.value("Pass").toString();
+        c->Uuid = settings.value("Uuid").toUuid();
+        c->Group = settings.value("Parent").toUuid();
+        c->Dynamic = false;
+
+        connections->insert(c->Uuid, c);
+    }
+    settings.endArray();
+}
+
+void ConnectionStore::Changed(GroupData *grp)
+{
+    removed.remove(grp->Uuid);
+    dirtyGroups[grp->Uuid] = grp;
+
+    saveTimer->start();
+}
+
+void ConnectionStore::Changed(ConnectionData *c)
+{
+    if (c->Dynamic)
+        return;
+
+    removed.remove(c->Uuid);
+    dirtyConnections[c->Uuid] = c;
+
+    saveTimer->start();
+}
+
+void ConnectionStore::Changed(JobData *job)
+{
+    removed.remove(job->Uuid);
+    dirtyJobs[job->Uuid] = job;
+
+    saveTimer->start();
+}
+
+// Must be called before the record is deleted
+void ConnectionStore::Removed(QUuid uuid)
+{
+    dirtyGroups.remove(uuid);
+    dirtyConnections.remove(uuid);
+    dirtyJobs.remove(uuid);
+    removed.insert(uuid);
+
+    saveTimer->start();
+}
+
+bool ConnectionStore::IsReadOnly()
+{
+    return readOnly;
+}
+
+bool ConnectionStore::IsEmpty()
+{
+    return dirtyGroups.isEmpty() && dirtyConnections.isEmpty() && dirtyJobs.isEmpty() && removed.isEmpty();
+}
+
+// Copy the dirty records so the worker never sees the live ones
+ConnectionStore::Batch ConnectionStore::TakeBatch()
+{
+    Batch batch;
+
+    foreach (GroupData *grp, dirtyGroups)
+        batch.Groups.append(*grp);
+    foreach (ConnectionData *c, dirtyConnections)
+        batch.Connections.append(*c);
+    foreach (JobData *job, dirtyJobs)
+        batch.Jobs.append(*job);
+    batch.Removed = removed.toList();
+
+    dirtyGroups.clear();
+    dirtyConnections.clear();
+    dirtyJobs.clear();
+    removed.clear();
+
+    return batch;
+}
+
+void ConnectionStore::Save()
+{
+    // One write at a time, the rest waits for Saved()
+    if (readOnly || writer->isRunning() || IsEmpty())
+        return;
+
+    writer->setFuture(QtConcurrent::run(&ConnectionStore::Write, TakeBatch()));
+}
+
+void ConnectionStore::Saved()
+{
+    if (!IsEmpty())
+        saveTimer->start();
+}
+
+// Write whatever is pending and wait for it, used at exit
+void ConnectionStore::Flush()
+{
+    saveTimer->stop();
+    writer->waitForFinished();
+
+    if (!readOnly && !IsEmpty())
+        Write(TakeBatch());
+}
+
+// Runs on a worker thread
+void ConnectionStore::Write(Batch batch)
+{
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation));
+
+    if (batch.Snapshot)
+        WriteSnapshot(batch);
+    else
+        AppendJournal(batch);
+}
+
+// The snapshot is replaced atomically, so a crash leaves either the
+// old one and its journal or the new one.
+void ConnectionStore::WriteSnapshot(const Batch &batch)
+{
+    QSaveFile f(FileName());
+    if (!f.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "Could not write connection store" << FileName();
+        return;
+    }
+
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_6);
+
+    out << StoreMagic << StoreVersion;
+
+    out << quint32(batch.Groups.size());
+    foreach (const GroupData &grp, batch.Groups)
+        WriteGroup(out, grp);
+
+    out << quint32(batch.Connections.size());
+    foreach (const ConnectionData &c, batch.Connections)
+        WriteConnection(out, c);
+
+    out << quint32(batch.Jobs.size());
+    foreach (const JobData &job, batch.Jobs)
+        WriteJob(out, job);
+
+    if (!f.commit())
+    {
+        qWarning() << "Could not write connection store" << FileName();
+        return;
+    }
+
+    QFile::remove(JournalName());
+
+    // The old settings are only dropped once they are safe on disk
+    if (batch.Migrated)
+    {
+        QSettings settings;
+        settings.remove("Groups");
+        settings.remove("Connections");
+    }
+}
+
+void ConnectionStore::AppendJournal(const Batch &batch)
+{
+    QFile f(JournalName());
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Append))
+    {
+        qWarning() << "Could not write connection journal" << JournalName();
+        return;
+    }
+
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_6);
+
+    if (f.size() == 0)
+        out << JournalMagic << StoreVersion;
+
+    foreach (const GroupData &grp, batch.Groups)
+    {
+        out << quint8(JournalGroup);
+        WriteGroup(out, grp);
+    }
+
+    foreach (const ConnectionData &c, batch.Connections)
+    {
+        out << quint8(JournalConnection);
+        WriteConnection(out, c);
+    }
+
+    foreach (const JobData &job, batch.Jobs)
+    {
+        out << quint8(JournalJob);
+        WriteJob(out, job);
+    }
+
+    foreach (QUuid uuid, batch.Removed)
+        out << quint8(JournalRemoved) << uuid;
+
+    f.close();
+}
+
+// Write the list as JSON Lines, one record per line, groups first
+bool ConnectionStore::Export(QString fileName, QList<GroupData *> groups, QList<ConnectionData *> connections)
+{
+    QSaveFile f(fileName);
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+
+    foreach (GroupData *grp, groups)
+    {
+        QJsonObject o;
+        o["type"] = QString("group");
+        o["uuid"] = grp->Uuid.toString();
+        o["name"] = grp->Name;
+        if (!grp->Dns.isNull())
+            o["dns"] = grp->Dns.toString();
+        o["dynamic"] = grp->Dynamic;
+        o["source"] = grp->Source;
+        o["refresh"] = grp->RefreshInterval;
+        o["user"] = grp->User;
+        o["pass"] = grp->Pass;
+
+        f.write(QJsonDocument(o).toJson(QJsonDocument::Compact));
+        f.write("\n");
+    }
+
+    foreach (ConnectionData *c, connections)
+    {
+        if (c->Dynamic)
+            continue;
+
+        QJsonObject o;
+        o["type"] = QString("connection");
+        o["uuid"] = c->Uuid.toString();
+        o["name"] = c->Name;
+        if (!c->Group.isNull())
+            o["group"] = c->Group.toString();
+        o["host"] = c->Host;
+        o["port"] = c->Port;
+        o["user"] = c->User;
+        o["pass"] = c->Pass;
+
+        f.write(QJsonDocument(o).toJson(QJsonDocument::Compact));
+        f.write("\n");
+    }
+
+    return f.commit();
+}
+
+// Read a JSON Lines file line by line. Lines that don't parse are
+// skipped, records without a UUID get a new one.
+bool ConnectionStore::Import(QString fileName, QList<GroupData *> *groups, QList<ConnectionData *> *connections)
+{
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    while (!f.atEnd())
+    {
+        QByteArray line = f.readLine().trimmed();
+        if (line.isEmpty())
+            continue;
+
+        QJsonObject o = QJsonDocument::fromJson(line).object();
+        if (o.isEmpty())
+            continue;
+
+        QUuid uuid(o["uuid"].toString());
+        if (uuid.isNull())
+            uuid = QUuid::createUuid();
+
+        if (o["type"].toString() == "group")
+        {
+            GroupData *grp = new GroupData();
+
+            grp->Uuid = uuid;
+            grp->Name = o["name"].toString();
+            if (o.contains("dns"))
+                grp->Dns = QHostAddress(o["dns"].toString());
+            grp->Dynamic = o["dynamic"].toBool();
+            grp->Source = o["source"].toString();
+            grp->RefreshInterval = o["refresh"].toInt(0);
+            grp->User = o["user"].toString();
+            grp->Pass = o["pass"].toString();
+
+            groups->append(grp);
+        }
+        else if (o["type"].toString() == "connection")
+        {
+            ConnectionData *c = new ConnectionData;
+
+            c->Uuid = uuid;
+            c->Name = o["name"].toString();
+            c->Group = QUuid(o["group"].toString());
+            c->Host = o["host"].toString();
+            c->Port = o["port"].toInt(9000);
+            c->User = o["user"].toString();
+            c->Pass = o["pass"].toString();
+            c->Dynamic = false;
+
+            connections->append(c);
+        }
+    }
+
+    return true;
+}
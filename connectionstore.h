@@ -0,0 +1,98 @@
+#ifndef CONNECTIONSTORE_H
+#define CONNECTIONSTORE_H
+
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <QList>
+#include <QUuid>
+
+#include "connectiondata.h"
+#include "groupdata.h"
+#include "jobdata.h"
+
+class QTimer;
+class QDataStream;
+template <typename T> class QFutureWatcher;
+
+// Saves the groups, connections and scheduled jobs the user keeps. The list lives in a
+// binary snapshot that loads with a single read, plus a journal that
+// changes are appended to. Records are marked dirty as they change and
+// appended a moment later, on a worker thread. The journal is folded
+// into a new snapshot at the next start.
+//
+// Members of dynamic groups are never saved. A snapshot or journal that
+// cannot be read is left alone and nothing is written until it is fixed
+// or removed.
+class ConnectionStore : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ConnectionStore(QObject *parent = 0);
+    ~ConnectionStore();
+
+    void Load(QList<GroupData *> *groups, QList<ConnectionData *> *connections, QList<JobData *> *jobs);
+    void Changed(GroupData *grp);
+    void Changed(ConnectionData *c);
+    void Changed(JobData *job);
+    void Removed(QUuid uuid);
+    void Flush();
+    bool IsReadOnly();
+
+    static bool Export(QString fileName, QList<GroupData *> groups, QList<ConnectionData *> connections);
+    static bool Import(QString fileName, QList<GroupData *> *groups, QList<ConnectionData *> *connections);
+
+protected slots:
+    void Save();
+    void Saved();
+
+protected:
+    struct Batch
+    {
+        Batch() : Snapshot(false), Migrated(false) {}
+
+        QList<GroupData> Groups;
+        QList<ConnectionData> Connections;
+        QList<JobData> Jobs;
+        QList<QUuid> Removed;
+        bool Snapshot;
+        bool Migrated;
+    };
+
+    Batch TakeBatch();
+    bool IsEmpty();
+    static void Write(Batch batch);
+    static void WriteSnapshot(const Batch &batch);
+    static void AppendJournal(const Batch &batch);
+    static QString Key(QUuid uuid);
+    static QString FileName();
+    static QString JournalName();
+    static void WriteGroup(QDataStream &out, const GroupData &grp);
+    static void WriteConnection(QDataStream &out, const ConnectionData &c);
+    static bool ReadGroup(QDataStream &in, GroupData *grp, quint32 version);
+    static bool ReadConnection(QDataStream &in, ConnectionData *c);
+    static void WriteJob(QDataStream &out, const JobData &job);
+    static bool ReadJob(QDataStream &in, JobData *job);
+    enum SnapshotState
+    {
+        SnapshotMissing,
+        SnapshotRead,
+        SnapshotUnreadable
+    };
+
+    SnapshotState ReadSnapshot(QHash<QUuid, GroupData *> *groups, QHash<QUuid, ConnectionData *> *connections, QHash<QUuid, JobData *> *jobs);
+    int ReadJournal(QHash<QUuid, GroupData *> *groups, QHash<QUuid, ConnectionData *> *connections, QHash<QUuid, JobData *> *jobs);
+    bool LoadSettings(QHash<QUuid, GroupData *> *groups, QHash<QUuid, ConnectionData *> *connections);
+    void Migrate(QHash<QUuid, GroupData *> *groups, QHash<QUuid, ConnectionData *> *connections);
+
+    QHash<QUuid, GroupData *> dirtyGroups;
+    QHash<QUuid, ConnectionData *> dirtyConnections;
+    QHash<QUuid, JobData *> dirtyJobs;
+    QSet<QUuid> removed;
+    QTimer *saveTimer;
+    QFutureWatcher<void> *writer;
+    bool readOnly;
+};
+
+#endif // CONNECTIONSTORE_H
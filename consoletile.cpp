@@ -0,0 +1,158 @@
+#include "consoletile.h"
+#include "connectionpane.h"
+#include "linebuffer.h"
+#include "panetheme.h"
+#include "timeseries.h"
+
+#include <QPainter>
+#include <QFontMetrics>
+#include <QMouseEvent>
+#include <QPolygonF>
+
+// Metrics shown under the output, at most
+static const int MaxMetrics = 4;
+
+ConsoleTile::ConsoleTile(ConnectionPane *pane, QWidget *parent) :
+    QWidget(parent),
+    pane(pane),
+    dirty(false)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMinimumSize(120, 60);
+
+    QFont f = PaneTheme::Current().Font;
+    f.setPointSize(8);
+    setFont(f);
+
+    connect(pane, SIGNAL(LinesAdded()), this, SLOT(LinesAdded()));
+}
+
+ConnectionPane *ConsoleTile::Pane()
+{
+    return pane;
+}
+
+// Several polls between two frames make one repaint
+void ConsoleTile::LinesAdded()
+{
+    if (dirty)
+        return;
+
+    dirty = true;
+    emit Dirty();
+}
+
+bool ConsoleTile::TakeDirty()
+{
+    bool was = dirty;
+    dirty = false;
+    return was;
+}
+
+void ConsoleTile::paintEvent(QPaintEvent *)
+{
+    QPainter p(this);
+
+    const QPalette &palette = PaneTheme::Current().Palette;
+    p.fillRect(rect(), palette.color(QPalette::Base));
+
+    QFontMetrics fm(font());
+    int lineHeight = fm.lineSpacing();
+
+    // Title strip with the region name
+    QRect title(0, 0, width(), lineHeight + 4);
+    p.fillRect(title, palette.color(QPalette::Window));
+    p.setPen(palette.color(QPalette::WindowText));
+    p.drawText(title.adjusted(4, 0, -4, 0), Qt::AlignVCenter | Qt::AlignLeft,
+               pane ? pane->GetName() : QString());
+
+    p.setPen(palette.color(QPalette::Mid));
+    p.drawRect(rect().adjusted(0, 0, -1, -1));
+
+    if (!pane)
+        return;
+
+    // A sparkline for each metric the session reports, at the bottom
+    const QMap<QString, TimeSeries> &metrics = pane->Metrics();
+    int rows = qMin(metrics.size(), MaxMetrics);
+    int stripTop = height() - 2 - rows * lineHeight;
+
+    QMap<QString, TimeSeries>::const_iterator it = metrics.constBegin();
+    for (int row = 0 ; row < rows ; row++, ++it)
+    {
+        QRect r(2, stripTop + row * lineHeight, width() - 4, lineHeight);
+        int split = r.width() * 2 / 5;
+
+        p.setPen(palette.color(QPalette::Text));
+        p.drawText(r.adjusted(2, 0, -(r.width() - split), 0), Qt::AlignVCenter | Qt::AlignLeft,
+                   it.key() + QString(" ") + QString::number(it.value().Last(), 'g', 4));
+
+        QRect spark = r.adjusted(split, 2, -2, -2);
+        PaintSparkline(p, spark, it.value().Recent(spark.width() / 2));
+    }
+
+    const LineBuffer &lines = pane->Lines();
+
+    // Only the lines that fit are looked at, newest at the bottom
+    int y = stripTop - 1 - fm.descent();
+    int top = title.bottom() + lineHeight;
+
+    for (int i = lines.Count() - 1 ; i >= 0 && y >= top ; i--)
+    {
+        const ConsoleLine &line = lines.At(i);
+
+        switch (line.Level)
+        {
+        case ConsoleLine::Error:
+            p.setPen(QColor(0xff, 0x00, 0x00));
+            break;
+        case ConsoleLine::Warn:
+            p.setPen(QColor(0xcf, 0xcf, 0x00));
+            break;
+        case ConsoleLine::Command:
+            p.setPen(QColor(0x00, 0x00, 0xff));
+            break;
+        default:
+            p.setPen(palette.color(QPalette::Text));
+            break;
+        }
+
+        p.drawText(4, y, line.Text);
+        y -= lineHeight;
+    }
+}
+
+// Scaled to the range of what is shown, newest on the right
+void ConsoleTile::PaintSparkline(QPainter &p, QRect r, QVector<float> values)
+{
+    if (values.size() < 2 || r.width() < 2 || r.height() < 2)
+        return;
+
+    float low = values.at(0);
+    float high = values.at(0);
+    for (int i = 1 ; i < values.size() ; i++)
+    {
+        low = qMin(low, values.at(i));
+        high = qMax(high, values.at(i));
+    }
+
+    float range = high - low;
+    if (range <= 0)
+        range = 1;
+
+    QPolygonF line;
+    line.reserve(values.size());
+
+    qreal step = qreal(r.width()) / (values.size() - 1);
+    for (int i = 0 ; i < values.size() ; i++)
+        line.append(QPointF(r.left() + i * step, r.bottom() - (values.at(i) - low) / range * r.height()));
+
+    p.setPen(QColor(0x00, 0x80, 0xc0));
+    p.drawPolyline(line);
+}
+
+void ConsoleTile::mouseDoubleClickEvent(QMouseEvent *)
+{
+    if (pane)
+        emit Activated(pane);
+}
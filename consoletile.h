@@ -0,0 +1,41 @@
+#ifndef CONSOLETILE_H
+#define CONSOLETILE_H
+
+#include <QWidget>
+#include <QPointer>
+#include <QVector>
+
+class QPainter;
+
+class ConnectionPane;
+
+// A small read-only view of a console, for the dashboard. It paints the
+// last lines of the session that fit, straight from the pane's line
+// buffer, and only when the dashboard asks it to.
+class ConsoleTile : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ConsoleTile(ConnectionPane *pane, QWidget *parent = 0);
+
+    ConnectionPane *Pane();
+    bool TakeDirty();
+
+signals:
+    void Dirty();
+    void Activated(ConnectionPane *pane);
+
+protected slots:
+    void LinesAdded();
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    void mouseDoubleClickEvent(QMouseEvent *event);
+    static void PaintSparkline(QPainter &p, QRect r, QVector<float> values);
+
+    QPointer<ConnectionPane> pane;
+    bool dirty;
+};
+
+#endif // CONSOLETILE_H
@@ -0,0 +1,110 @@
+#include "dashboardview.h"
+#include "consoletile.h"
+#include "connectionpane.h"
+
+#include <QGridLayout>
+#include <QTimer>
+#include <QShowEvent>
+
+#include <math.h>
+
+// About 30 repaints a second at most
+static const int FrameInterval = 33;
+
+DashboardView::DashboardView(QWidget *parent) :
+    QWidget(parent)
+{
+    grid = new QGridLayout(this);
+    grid->setContentsMargins(2, 2, 2, 2);
+    grid->setSpacing(2);
+
+    frameTimer = new QTimer(this);
+    frameTimer->setSingleShot(true);
+    frameTimer->setInterval(FrameInterval);
+    connect(frameTimer, SIGNAL(timeout()), this, SLOT(Frame()));
+}
+
+// Tiles of panes that are still shown are kept as they are
+void DashboardView::SetPanes(QList<ConnectionPane *> panes)
+{
+    QList<ConsoleTile *> kept;
+
+    foreach (ConsoleTile *tile, tiles)
+    {
+        if (tile->Pane() && panes.contains(tile->Pane()))
+            kept.append(tile);
+        else
+            delete tile;
+    }
+
+    tiles.clear();
+
+    foreach (ConnectionPane *pane, panes)
+    {
+        ConsoleTile *tile = 0;
+
+        foreach (ConsoleTile *t, kept)
+        {
+            if (t->Pane() == pane)
+            {
+                tile = t;
+                break;
+            }
+        }
+
+        if (tile == 0)
+        {
+            tile = new ConsoleTile(pane, this);
+            connect(tile, SIGNAL(Dirty()), this, SLOT(ScheduleFrame()));
+            connect(tile, SIGNAL(Activated(ConnectionPane *)), this, SIGNAL(Activated(ConnectionPane *)));
+        }
+
+        tiles.append(tile);
+    }
+
+    Arrange();
+}
+
+// As square a grid as the number of tiles allows
+void DashboardView::Arrange()
+{
+    while (grid->count())
+        delete grid->takeAt(0);
+
+    int columns = int(ceil(sqrt(double(tiles.size()))));
+    if (columns < 1)
+        columns = 1;
+
+    for (int i = 0 ; i < tiles.size() ; i++)
+        grid->addWidget(tiles.at(i), i / columns, i % columns);
+
+    for (int i = 0 ; i < tiles.size() ; i++)
+        tiles.at(i)->update();
+}
+
+void DashboardView::ScheduleFrame()
+{
+    if (!frameTimer->isActive())
+        frameTimer->start();
+}
+
+// While the dashboard is hidden the tiles only collect the fact that
+// they changed
+void DashboardView::Frame()
+{
+    if (!isVisible())
+        return;
+
+    foreach (ConsoleTile *tile, tiles)
+    {
+        if (tile->TakeDirty())
+            tile->update();
+    }
+}
+
+void DashboardView::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+
+    Frame();
+}
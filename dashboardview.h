@@ -0,0 +1,39 @@
+#ifndef DASHBOARDVIEW_H
+#define DASHBOARDVIEW_H
+
+#include <QWidget>
+#include <QList>
+
+class ConnectionPane;
+class ConsoleTile;
+class QGridLayout;
+class QTimer;
+
+// Many consoles at once, as tiles in a grid. Tiles with new output are
+// repainted together once per frame, however often their sessions poll.
+class DashboardView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit DashboardView(QWidget *parent = 0);
+
+    void SetPanes(QList<ConnectionPane *> panes);
+
+signals:
+    void Activated(ConnectionPane *pane);
+
+protected slots:
+    void ScheduleFrame();
+    void Frame();
+
+protected:
+    void showEvent(QShowEvent *event);
+    void Arrange();
+
+    QList<ConsoleTile *> tiles;
+    QGridLayout *grid;
+    QTimer *frameTimer;
+};
+
+#endif // DASHBOARDVIEW_H
@@ -1,6 +1,10 @@
 #include "groupdata.h"
 
-GroupData::GroupData()
+GroupData::GroupData() :
+    Dynamic(false),
+    Expanded(false),
+    RefreshInterval(0),
+    LastLoaded(0)
 {
 
 }
@@ -4,6 +4,7 @@
 #include <QUuid>
 #include <QString>
 #include <QHostAddress>
+#include <QByteArray>
 
 class GroupData
 {
@@ -18,6 +19,14 @@ public:
     QString Source;
     QString User;
     QString Pass;
+
+    bool Expanded;
+    int RefreshInterval;
+
+    // Not saved, used to refresh dynamic groups
+    QByteArray ETag;
+    QByteArray LastModified;
+    qint64 LastLoaded;
 };
 
 #endif // GROUPDATA_H
@@ -0,0 +1,208 @@
+#include "healthprober.h"
+#include "connectiondata.h"
+#include "connectionmodel.h"
+
+#include <QTcpSocket>
+#include <QTimer>
+
+// Probes in flight at once, and how long one may take in total
+static const int MaxParallel = 128;
+static const int ProbeTimeout = 1500;
+
+// Pause between the end of a sweep and the start of the next one
+static const int SweepInterval = 60000;
+
+HealthProber::HealthProber(QObject *parent) :
+    QObject(parent),
+    sweepStarted(0),
+    up(0),
+    enabled(true)
+{
+    clock.start();
+
+    // One timer checks all deadlines instead of one timer per probe
+    tickTimer = new QTimer(this);
+    tickTimer->setInterval(100);
+    connect(tickTimer, SIGNAL(timeout()), this, SLOT(Tick()));
+
+    sweepTimer = new QTimer(this);
+    sweepTimer->setSingleShot(true);
+    sweepTimer->setInterval(SweepInterval);
+    connect(sweepTimer, SIGNAL(timeout()), this, SIGNAL(SweepDue()));
+}
+
+bool HealthProber::IsRunning()
+{
+    return !active.isEmpty() || !queue.isEmpty();
+}
+
+void HealthProber::SetEnabled(bool enable)
+{
+    if (enable == enabled)
+        return;
+
+    enabled = enable;
+
+    if (enabled)
+    {
+        emit SweepDue();
+        return;
+    }
+
+    sweepTimer->stop();
+    queue.clear();
+
+    foreach (QTcpSocket *socket, active.keys())
+    {
+        socket->abort();
+        socket->deleteLater();
+    }
+    active.clear();
+    tickTimer->stop();
+}
+
+// Start a sweep over the given connections. Connections that share an
+// endpoint are probed once.
+void HealthProber::Sweep(QList<ConnectionData *> connections)
+{
+    if (!enabled || IsRunning())
+        return;
+
+    targets.clear();
+
+    foreach (ConnectionData *c, connections)
+    {
+        QString key = c->Host.toLower() + QString(":") + QString::number(c->Port);
+
+        Target &t = targets[key];
+        t.Host = c->Host;
+        t.Port = c->Port;
+        t.Uuids.append(c->Uuid);
+    }
+
+    queue = targets.keys();
+    up = 0;
+    sweepStarted = clock.elapsed();
+
+    tickTimer->start();
+    StartProbes();
+}
+
+void HealthProber::StartProbes()
+{
+    while (active.size() < MaxParallel && !queue.isEmpty())
+    {
+        QString key = queue.takeFirst();
+        const Target &t = targets[key];
+
+        QTcpSocket *socket = new QTcpSocket(this);
+
+        Probe p;
+        p.Key = key;
+        p.Host = t.Host;
+        p.Port = t.Port;
+        p.Deadline = clock.elapsed() + ProbeTimeout;
+        p.Connected = false;
+        active[socket] = p;
+
+        connect(socket, SIGNAL(connected()), this, SLOT(Connected()));
+        connect(socket, SIGNAL(readyRead()), this, SLOT(DataReady()));
+        connect(socket, SIGNAL(error(QAbstractSocket::SocketError)), this, SLOT(Error(QAbstractSocket::SocketError)));
+
+        socket->connectToHost(t.Host, t.Port);
+    }
+
+    if (active.isEmpty() && queue.isEmpty())
+    {
+        tickTimer->stop();
+        emit SweepDone(up, targets.size(), clock.elapsed() - sweepStarted);
+
+        if (enabled)
+            sweepTimer->start();
+    }
+}
+
+void HealthProber::Connected()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!active.contains(socket))
+        return;
+
+    Probe &p = active[socket];
+    p.Connected = true;
+
+    QByteArray request = QByteArray("GET /simstatus/ HTTP/1.0\r\nHost: ") +
+            p.Host.toUtf8() + QByteArray(":") + QByteArray::number(p.Port) +
+            QByteArray("\r\nConnection: close\r\n\r\n");
+
+    socket->write(request);
+}
+
+// The status line is all we need
+void HealthProber::DataReady()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!active.contains(socket))
+        return;
+
+    Probe &p = active[socket];
+    p.Response.append(socket->readAll());
+
+    int eol = p.Response.indexOf("\r\n");
+    if (eol < 0)
+    {
+        if (p.Response.size() > 1024)
+            Finish(socket, StatusDegraded);
+        return;
+    }
+
+    QList<QByteArray> status = p.Response.left(eol).split(' ');
+    if (status.size() >= 2 && status.at(0).startsWith("HTTP/") && status.at(1) == "200")
+        Finish(socket, StatusUp);
+    else
+        Finish(socket, StatusDegraded);
+}
+
+// Refused or unreachable is down. If the port took the connection but
+// didn't answer the request, the simulator is there but not well.
+void HealthProber::Error(QAbstractSocket::SocketError)
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>(sender());
+    if (!active.contains(socket))
+        return;
+
+    Finish(socket, active[socket].Connected ? StatusDegraded : StatusDown);
+}
+
+void HealthProber::Tick()
+{
+    qint64 now = clock.elapsed();
+
+    QList<QTcpSocket *> expired;
+    for (QHash<QTcpSocket *, Probe>::const_iterator it = active.constBegin() ; it != active.constEnd() ; ++it)
+    {
+        if (it.value().Deadline <= now)
+            expired.append(it.key());
+    }
+
+    foreach (QTcpSocket *socket, expired)
+        Finish(socket, active[socket].Connected ? StatusDegraded : StatusDown);
+}
+
+void HealthProber::Finish(QTcpSocket *socket, int status)
+{
+    Probe p = active.take(socket);
+
+    socket->disconnect(this);
+    socket->abort();
+    socket->deleteLater();
+
+    if (status == StatusUp)
+        up++;
+
+    // The model ignores reports that don't change anything
+    foreach (QUuid uuid, targets[p.Key].Uuids)
+        emit StatusChanged(uuid, status);
+
+    StartProbes();
+}
@@ -0,0 +1,75 @@
+#ifndef HEALTHPROBER_H
+#define HEALTHPROBER_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+#include <QUuid>
+#include <QAbstractSocket>
+#include <QElapsedTimer>
+
+class ConnectionData;
+class QTcpSocket;
+class QTimer;
+
+// Checks whether the simulators in the list are up. Each distinct
+// host:port gets a TCP connect followed by a GET of /simstatus/, with a
+// short deadline for both. A bounded number of probes run at a time, all
+// on the event loop, and a new sweep starts a while after the last one
+// finished.
+class HealthProber : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HealthProber(QObject *parent = 0);
+
+    void Sweep(QList<ConnectionData *> connections);
+    void SetEnabled(bool enable);
+    bool IsRunning();
+
+signals:
+    void StatusChanged(QUuid uuid, int status);
+    void SweepDone(int up, int total, qint64 elapsed);
+    void SweepDue();
+
+protected slots:
+    void Connected();
+    void DataReady();
+    void Error(QAbstractSocket::SocketError error);
+    void Tick();
+
+protected:
+    struct Probe
+    {
+        QString Key;
+        QString Host;
+        int Port;
+        qint64 Deadline;
+        bool Connected;
+        QByteArray Response;
+    };
+
+    struct Target
+    {
+        QString Host;
+        int Port;
+        QList<QUuid> Uuids;
+    };
+
+    void StartProbes();
+    void Finish(QTcpSocket *socket, int status);
+
+    QHash<QString, Target> targets;
+    QStringList queue;
+    QHash<QTcpSocket *, Probe> active;
+    QTimer *tickTimer;
+    QTimer *sweepTimer;
+    QElapsedTimer clock;
+    qint64 sweepStarted;
+    int up;
+    bool enabled;
+};
+
+#endif // HEALTHPROBER_H
@@ -0,0 +1,172 @@
+#include "helpindex.h"
+#include "commandtree.h"
+
+#include <QRegExp>
+
+#include <algorithm>
+#include <math.h>
+
+HelpIndex::HelpIndex() :
+    documents(0)
+{
+}
+
+void HelpIndex::Clear()
+{
+    postings.clear();
+    terms.clear();
+    documents = 0;
+}
+
+// Lower case words of two or more letters or digits
+QStringList HelpIndex::Terms(QString text)
+{
+    QStringList result;
+
+    QStringList words = text.toLower().split(QRegExp("[^\\w]+"), QString::SkipEmptyParts);
+    foreach (QString w, words)
+    {
+        if (w.size() >= 2)
+            result.append(w);
+    }
+
+    return result;
+}
+
+// A word in the usage line says more about a command than one in its
+// description, which in turn says more than one in the long help.
+QHash<QString, int> HelpIndex::Weights(const CommandData &cmd)
+{
+    QHash<QString, int> weights;
+
+    foreach (QString t, Terms(cmd.HelpText))
+        weights[t] += 3;
+    foreach (QString t, Terms(cmd.Description))
+        weights[t] += 2;
+    foreach (QString t, Terms(cmd.LongHelp))
+        weights[t] += 1;
+
+    return weights;
+}
+
+void HelpIndex::Add(int id, const CommandData &cmd)
+{
+    QHash<QString, int> weights = Weights(cmd);
+
+    for (QHash<QString, int>::const_iterator it = weights.constBegin() ; it != weights.constEnd() ; ++it)
+    {
+        Posting p;
+        p.Id = id;
+        p.Weight = it.value();
+        postings[it.key()].append(p);
+    }
+
+    documents++;
+}
+
+void HelpIndex::Remove(int id, const CommandData &cmd)
+{
+    QHash<QString, int> weights = Weights(cmd);
+
+    for (QHash<QString, int>::const_iterator it = weights.constBegin() ; it != weights.constEnd() ; ++it)
+    {
+        QVector<Posting> &list = postings[it.key()];
+
+        for (int i = 0 ; i < list.size() ; i++)
+        {
+            if (list.at(i).Id == id)
+            {
+                list.remove(i);
+                break;
+            }
+        }
+
+        if (list.isEmpty())
+            postings.remove(it.key());
+    }
+
+    documents--;
+}
+
+void HelpIndex::Finalize()
+{
+    terms = postings.keys();
+    std::sort(terms.begin(), terms.end());
+
+    for (QHash<QString, QVector<Posting> >::iterator it = postings.begin() ; it != postings.end() ; ++it)
+        it.value().squeeze();
+}
+
+// Roughly what the index takes up, for the memory accounting
+qint64 HelpIndex::Bytes() const
+{
+    qint64 bytes = sizeof(HelpIndex);
+
+    for (QHash<QString, QVector<Posting> >::const_iterator it = postings.constBegin() ; it != postings.constEnd() ; ++it)
+        bytes += 64 + it.key().capacity() * 2 + it.value().capacity() * sizeof(Posting);
+
+    foreach (const QString &term, terms)
+        bytes += sizeof(void *) + 24 + term.capacity() * 2;
+
+    return bytes;
+}
+
+// Commands matching all words of the query, best first. A query word
+// matches index words it is a prefix of, exact matches count double.
+// Rare words weigh more than common ones.
+QList<int> HelpIndex::Search(QString query, int limit) const
+{
+    QStringList words = Terms(query);
+    QList<int> results;
+
+    if (words.isEmpty())
+        return results;
+
+    QHash<int, double> scores;
+    QHash<int, int> matched;
+
+    foreach (QString word, words)
+    {
+        QHash<int, double> best;
+
+        QStringList::const_iterator it = std::lower_bound(terms.constBegin(), terms.constEnd(), word);
+        for ( ; it != terms.constEnd() && it->startsWith(word) ; ++it)
+        {
+            const QVector<Posting> &list = postings[*it];
+
+            double idf = log(1.0 + double(documents) / double(list.size()));
+            if (*it != word)
+                idf *= 0.5;
+
+            for (int i = 0 ; i < list.size() ; i++)
+            {
+                double score = list.at(i).Weight * idf;
+                if (score > best.value(list.at(i).Id, 0.0))
+                    best[list.at(i).Id] = score;
+            }
+        }
+
+        for (QHash<int, double>::const_iterator b = best.constBegin() ; b != best.constEnd() ; ++b)
+        {
+            scores[b.key()] += b.value();
+            matched[b.key()]++;
+        }
+    }
+
+    for (QHash<int, int>::const_iterator m = matched.constBegin() ; m != matched.constEnd() ; ++m)
+    {
+        if (m.value() == words.size())
+            results.append(m.key());
+    }
+
+    std::sort(results.begin(), results.end(), [&scores](int a, int b) -> bool {
+        if (scores.value(a) != scores.value(b))
+            return scores.value(a) > scores.value(b);
+        return a < b;
+    });
+
+    if (limit > 0 && results.size() > limit)
+        results = results.mid(0, limit);
+
+    return results;
+}
@@ -0,0 +1,44 @@
+#ifndef HELPINDEX_H
+#define HELPINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QList>
+
+struct CommandData;
+
+// Inverted index over the help texts of the commands in a tree, used
+// for apropos searches. Commands are added while the tree is parsed;
+// Finalize() sorts the vocabulary so query words also match as prefixes.
+class HelpIndex
+{
+public:
+    HelpIndex();
+
+    void Clear();
+    void Add(int id, const CommandData &cmd);
+    void Remove(int id, const CommandData &cmd);
+    void Finalize();
+
+    QList<int> Search(QString query, int limit) const;
+    qint64 Bytes() const;
+
+    static QStringList Terms(QString text);
+
+protected:
+    struct Posting
+    {
+        int Id;
+        int Weight;
+    };
+
+    static QHash<QString, int> Weights(const CommandData &cmd);
+
+    QHash<QString, QVector<Posting> > postings;
+    QStringList terms;
+    int documents;
+};
+
+#endif // HELPINDEX_H
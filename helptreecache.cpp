@@ -0,0 +1,163 @@
+#include "helptreecache.h"
+#include "connectionpane.h"
+
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QTimer>
+#include <QDebug>
+
+// Bump the version whenever the file layout or the set of local
+// commands added to every tree changes.
+static const quint32 CacheMagic = 0x48544331;
+static const quint32 CacheVersion = 2;
+static const int MaxTrees = 16;
+
+HelpTreeCache *HelpTreeCache::Instance()
+{
+    static HelpTreeCache *instance = 0;
+
+    if (instance == 0)
+        instance = new HelpTreeCache(QCoreApplication::instance());
+
+    return instance;
+}
+
+QByteArray HelpTreeCache::Hash(const QByteArray &helpTreeXml)
+{
+    return QCryptographicHash::hash(helpTreeXml, QCryptographicHash::Sha1);
+}
+
+HelpTreeCache::HelpTreeCache(QObject *parent) :
+    QObject(parent),
+    dirty(false)
+{
+    saveTimer = new QTimer(this);
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(2000);
+    connect(saveTimer, SIGNAL(timeout()), this, SLOT(Save()));
+
+    Load();
+}
+
+HelpTreeCache::~HelpTreeCache()
+{
+    if (dirty)
+        Save();
+}
+
+QSharedPointer<const CommandTree> HelpTreeCache::Find(const QByteArray &hash)
+{
+    QSharedPointer<const CommandTree> tree = trees.value(hash);
+
+    if (tree)
+        Touch(hash);
+
+    return tree;
+}
+
+// Take ownership of a freshly built tree. If another session got there
+// first, its copy is returned and the new one is dropped.
+QSharedPointer<const CommandTree> HelpTreeCache::Insert(const QByteArray &hash, CommandTree *tree)
+{
+    if (trees.contains(hash))
+    {
+        delete tree;
+        return Find(hash);
+    }
+
+    QSharedPointer<const CommandTree> shared(tree);
+    trees[hash] = shared;
+    Touch(hash);
+
+    // Sessions still using an evicted tree keep their own reference
+    while (recent.size() > MaxTrees)
+        trees.remove(recent.takeLast());
+
+    dirty = true;
+    saveTimer->start();
+
+    return shared;
+}
+
+void HelpTreeCache::Touch(const QByteArray &hash)
+{
+    recent.removeAll(hash);
+    recent.prepend(hash);
+}
+
+QString HelpTreeCache::FileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QString("/helptrees.cache");
+}
+
+void HelpTreeCache::Load()
+{
+    QFile f(FileName());
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+
+    QByteArray data = f.readAll();
+    f.close();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic;
+    quint32 version;
+    quint32 count;
+
+    in >> magic >> version >> count;
+    if (magic != CacheMagic || version != CacheVersion)
+        return;
+
+    QVector<CommandFn> handlers = ConnectionPane::Handlers();
+
+    for (quint32 i = 0 ; i < count && in.status() == QDataStream::Ok ; i++)
+    {
+        QByteArray hash;
+        in >> hash;
+
+        CommandTree *tree = new CommandTree();
+        if (!tree->Load(in, handlers))
+        {
+            qWarning() << "Help tree cache" << FileName() << "is damaged, ignoring the rest of it";
+            delete tree;
+            break;
+        }
+
+        trees[hash] = QSharedPointer<const CommandTree>(tree);
+        recent.append(hash);
+    }
+}
+
+void HelpTreeCache::Save()
+{
+    dirty = false;
+
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+
+    QSaveFile f(FileName());
+    if (!f.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_6);
+
+    out << CacheMagic << CacheVersion << quint32(recent.size());
+
+    QVector<CommandFn> handlers = ConnectionPane::Handlers();
+
+    foreach (QByteArray hash, recent)
+    {
+        out << hash;
+        trees[hash]->Save(out, handlers);
+    }
+
+    if (!f.commit())
+        qWarning() << "Could not write help tree cache" << FileName();
+}
@@ -0,0 +1,47 @@
+#ifndef HELPTREECACHE_H
+#define HELPTREECACHE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QSharedPointer>
+
+#include "commandtree.h"
+
+class QTimer;
+
+// Help trees keyed by a hash of the HelpTree XML they were built from.
+// Simulators running the same build send the same tree, so all their
+// sessions share one copy. The trees are also kept on disk, so a login
+// to a known build doesn't need to parse the tree at all.
+class HelpTreeCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static HelpTreeCache *Instance();
+    static QByteArray Hash(const QByteArray &helpTreeXml);
+
+    ~HelpTreeCache();
+
+    QSharedPointer<const CommandTree> Find(const QByteArray &hash);
+    QSharedPointer<const CommandTree> Insert(const QByteArray &hash, CommandTree *tree);
+
+protected slots:
+    void Save();
+
+protected:
+    explicit HelpTreeCache(QObject *parent = 0);
+
+    void Load();
+    void Touch(const QByteArray &hash);
+    QString FileName();
+
+    QHash<QByteArray, QSharedPointer<const CommandTree> > trees;
+    QList<QByteArray> recent;
+    QTimer *saveTimer;
+    bool dirty;
+};
+
+#endif // HELPTREECACHE_H
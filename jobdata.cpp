@@ -0,0 +1,8 @@
+#include "jobdata.h"
+
+JobData::JobData() :
+    Interval(3600),
+    Enabled(true)
+{
+
+}
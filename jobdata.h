@@ -0,0 +1,26 @@
+#ifndef JOBDATA_H
+#define JOBDATA_H
+
+#include <QUuid>
+#include <QString>
+
+// A command that runs on its own at a fixed interval, on one
+// connection, the members of a group, or every connection
+class JobData
+{
+public:
+    JobData();
+
+    QUuid Uuid;
+    QString Name;
+    QString Command;
+
+    // In seconds
+    int Interval;
+
+    // A group or connection, null for all
+    QUuid Target;
+    bool Enabled;
+};
+
+#endif // JOBDATA_H
@@ -0,0 +1,449 @@
+#include "jobscheduler.h"
+#include "connectionmodel.h"
+#include "connectiondata.h"
+#include "groupdata.h"
+#include "sessionmanager.h"
+
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QUrlQuery>
+#include <QDomDocument>
+#include <QDomElement>
+#include <QDomNodeList>
+#include <QTimer>
+
+// Runs in flight at once, and how long one may take in total
+static const int MaxParallel = 16;
+static const int RunTimeout = 60;
+
+// First runs are spread over the interval, but no more than this many
+// seconds, so a job that runs every few hours still starts soon
+static const int MaxStagger = 600;
+
+// Runs kept in the log of each job
+static const int MaxRunLog = 200;
+
+// Polls that may come back empty before the output is taken as complete
+static const int MaxEmptyPolls = 3;
+
+JobScheduler::JobScheduler(ConnectionModel *model, QObject *parent) :
+    QObject(parent),
+    model(model),
+    nextKey(1)
+{
+    clock.start();
+
+    manager = new QNetworkAccessManager(this);
+
+    tickTimer = new QTimer(this);
+    tickTimer->setInterval(1000);
+    connect(tickTimer, SIGNAL(timeout()), this, SLOT(Tick()));
+
+    // Dynamic groups add and drop members in bulk, one resync will do
+    resyncTimer = new QTimer(this);
+    resyncTimer->setSingleShot(true);
+    resyncTimer->setInterval(500);
+    connect(resyncTimer, SIGNAL(timeout()), this, SLOT(Resync()));
+
+    connect(model, SIGNAL(rowsInserted(const QModelIndex &, int, int)), this, SLOT(ScheduleResync()));
+    connect(model, SIGNAL(rowsRemoved(const QModelIndex &, int, int)), this, SLOT(ScheduleResync()));
+    connect(model, SIGNAL(modelReset()), this, SLOT(ScheduleResync()));
+}
+
+JobScheduler::~JobScheduler()
+{
+    waiting.clear();
+    foreach (quint64 key, running.keys())
+        Finish(key, false, QString("Cancelled"));
+
+    qDeleteAll(jobs);
+}
+
+qint64 JobScheduler::Seconds() const
+{
+    return clock.elapsed() / 1000;
+}
+
+void JobScheduler::SetJobs(QList<JobData *> list)
+{
+    qDeleteAll(jobs);
+    jobs = list;
+
+    Resync();
+}
+
+QList<JobData *> JobScheduler::Jobs() const
+{
+    return jobs;
+}
+
+JobData *JobScheduler::Job(QUuid uuid) const
+{
+    foreach (JobData *job, jobs)
+    {
+        if (job->Uuid == uuid)
+            return job;
+    }
+
+    return 0;
+}
+
+void JobScheduler::AddJob(JobData *job)
+{
+    jobs.append(job);
+
+    Resync();
+}
+
+void JobScheduler::Changed(QUuid uuid)
+{
+    Q_UNUSED(uuid);
+
+    Resync();
+}
+
+void JobScheduler::RemoveJob(QUuid uuid)
+{
+    JobData *job = Job(uuid);
+    if (job == 0)
+        return;
+
+    jobs.removeAll(job);
+    delete job;
+
+    runLog.remove(uuid);
+
+    Resync();
+}
+
+QList<JobRun> JobScheduler::RunLog(QUuid job) const
+{
+    return runLog.value(job);
+}
+
+int JobScheduler::Scheduled() const
+{
+    return wheel.Count();
+}
+
+int JobScheduler::Running() const
+{
+    return running.size();
+}
+
+void JobScheduler::ScheduleResync()
+{
+    resyncTimer->start();
+}
+
+// The connections a job runs on
+QList<QUuid> JobScheduler::TargetsOf(JobData *job) const
+{
+    QList<QUuid> result;
+
+    if (job->Target.isNull())
+    {
+        foreach (ConnectionData *c, model->Connections())
+            result.append(c->Uuid);
+    }
+    else if (model->Group(job->Target))
+    {
+        foreach (ConnectionData *c, model->Members(job->Target))
+            result.append(c->Uuid);
+    }
+    else if (model->Connection(job->Target))
+    {
+        result.append(job->Target);
+    }
+
+    return result;
+}
+
+// The offset stays the same for a pair, so its runs keep their place
+// in the interval from one session to the next
+qint64 JobScheduler::FirstDue(JobData *job, QUuid connection) const
+{
+    uint spread = uint(qMin(job->Interval, MaxStagger));
+    if (spread == 0)
+        spread = 1;
+
+    uint offset = (qHash(job->Uuid) ^ qHash(connection)) % spread;
+
+    return Seconds() + 1 + offset;
+}
+
+// Bring the wheel in line with the jobs and the connections they
+// target. Pairs that stay keep their deadline.
+void JobScheduler::Resync()
+{
+    resyncTimer->stop();
+
+    QHash<PairKey, quint64> stale = keys;
+
+    foreach (JobData *job, jobs)
+    {
+        if (!job->Enabled || job->Interval <= 0 || job->Command.trimmed().isEmpty())
+            continue;
+
+        foreach (QUuid connection, TargetsOf(job))
+        {
+            PairKey pair(job->Uuid, connection);
+
+            if (stale.remove(pair) > 0)
+            {
+                Plan &plan = plans[keys[pair]];
+                if (plan.Interval == job->Interval)
+                    continue;
+
+                plan.Interval = job->Interval;
+                plan.Due = FirstDue(job, connection);
+                wheel.Schedule(keys[pair], plan.Due);
+                continue;
+            }
+
+            Plan plan;
+            plan.Job = job->Uuid;
+            plan.Connection = connection;
+            plan.Interval = job->Interval;
+            plan.Due = FirstDue(job, connection);
+
+            quint64 key = nextKey++;
+            keys[pair] = key;
+            plans[key] = plan;
+            wheel.Schedule(key, plan.Due);
+        }
+    }
+
+    // A run in flight finishes, but isn't scheduled again
+    for (QHash<PairKey, quint64>::const_iterator it = stale.constBegin() ; it != stale.constEnd() ; ++it)
+    {
+        wheel.Cancel(it.value());
+        waiting.removeAll(it.value());
+        plans.remove(it.value());
+        keys.remove(it.key());
+    }
+
+    if (wheel.Count() > 0 || !running.isEmpty())
+        tickTimer->start();
+    else
+        tickTimer->stop();
+}
+
+void JobScheduler::Tick()
+{
+    qint64 now = Seconds();
+
+    foreach (quint64 key, wheel.Advance(now))
+    {
+        if (!plans.contains(key))
+            continue;
+
+        // The next run goes by the deadline, not by when this one
+        // starts, so the runs don't drift
+        Plan &plan = plans[key];
+        plan.Due += plan.Interval;
+        if (plan.Due <= now)
+            plan.Due = now + plan.Interval;
+        wheel.Schedule(key, plan.Due);
+
+        // A run that is still going or waiting is not started twice
+        if (running.contains(key) || waiting.contains(key))
+            continue;
+
+        waiting.append(key);
+    }
+
+    QList<quint64> expired;
+    for (QHash<quint64, Execution>::const_iterator it = running.constBegin() ; it != running.constEnd() ; ++it)
+    {
+        if (it.value().Deadline <= now)
+            expired.append(it.key());
+    }
+
+    foreach (quint64 key, expired)
+        Finish(key, false, QString("Timed out"));
+
+    StartRuns();
+
+    if (wheel.Count() == 0 && running.isEmpty() && waiting.isEmpty())
+        tickTimer->stop();
+}
+
+void JobScheduler::StartRuns()
+{
+    while (running.size() < MaxParallel && !waiting.isEmpty())
+        Start(waiting.takeFirst());
+}
+
+void JobScheduler::Start(quint64 key)
+{
+    const Plan &plan = plans[key];
+
+    ConnectionData *c = model->Connection(plan.Connection);
+    JobData *job = Job(plan.Job);
+    if (c == 0 || job == 0)
+        return;
+
+    Execution &e = running[key];
+    e.Key = key;
+    e.Job = job->Uuid;
+    e.Name = c->Name;
+    e.Stage = Starting;
+    e.Deadline = Seconds() + RunTimeout;
+    e.Prompted = false;
+    e.EmptyPolls = 0;
+    e.Reply = 0;
+
+    e.Base.setScheme(QString("http"));
+    e.Base.setHost(c->Host);
+    e.Base.setPort(c->Port);
+
+    QUrlQuery queryString;
+    queryString.addQueryItem("USER", c->User);
+    queryString.addQueryItem("PASS", c->Pass);
+
+    Post(&e, QString("/StartSession/"), queryString.query(QUrl::FullyEncoded).toUtf8());
+}
+
+void JobScheduler::Post(Execution *e, QString path, QByteArray data)
+{
+    QUrl url = e->Base;
+    url.setPath(path);
+
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/x-www-form-urlencoded"));
+
+    e->Reply = manager->post(request, data);
+    replies[e->Reply] = e->Key;
+    connect(e->Reply, SIGNAL(finished()), this, SLOT(Reply()));
+}
+
+void JobScheduler::Reply()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply || !replies.contains(reply))
+        return;
+
+    quint64 key = replies.take(reply);
+    reply->deleteLater();
+
+    Execution &e = running[key];
+    e.Reply = 0;
+
+    if (reply->error() != QNetworkReply::NoError)
+    {
+        Finish(key, false, reply->errorString());
+        return;
+    }
+
+    QByteArray result = reply->readAll();
+
+    if (e.Stage == Starting)
+    {
+        QDomDocument doc;
+        doc.setContent(result, false);
+
+        QDomNodeList sessionL = doc.documentElement().elementsByTagName(QString("SessionID"));
+        e.SessionID = sessionL.at(0).toElement().text();
+
+        if (e.SessionID.isEmpty())
+        {
+            Finish(key, false, QString("Login failed"));
+            return;
+        }
+
+        JobData *job = Job(e.Job);
+        if (job == 0)
+        {
+            Finish(key, false, QString("Job removed"));
+            return;
+        }
+
+        QUrlQuery queryString;
+        queryString.addQueryItem("ID", e.SessionID);
+        queryString.addQueryItem("COMMAND", job->Command);
+
+        e.Stage = Sending;
+        Post(&e, QString("/SessionCommand/"), queryString.query(QUrl::FullyEncoded).toUtf8());
+        return;
+    }
+
+    if (e.Stage == Reading)
+    {
+        QDomDocument doc;
+        doc.setContent(result, false);
+
+        QDomNodeList lineL = doc.documentElement().elementsByTagName(QString("Line"));
+
+        if (lineL.isEmpty())
+            e.EmptyPolls++;
+
+        // The login banner ends in a prompt as well, the output is only
+        // complete at a prompt that follows some of it
+        for (int i = 0 ; i < lineL.count() ; i++)
+        {
+            QDomElement line = lineL.at(i).toElement();
+
+            if (line.attribute("Prompt") == "true" || line.attribute("Command") == "true")
+            {
+                if (!e.Output.isEmpty())
+                    e.Prompted = true;
+                continue;
+            }
+
+            if (line.attribute("Input") == "true")
+                continue;
+
+            foreach (QString l, line.text().trimmed().split('\n', QString::SkipEmptyParts))
+                e.Output.append(l);
+        }
+
+        if (e.Prompted || e.EmptyPolls >= MaxEmptyPolls)
+        {
+            Finish(key, true, e.Output.isEmpty() ? QString() : e.Output.last());
+            return;
+        }
+    }
+
+    e.Stage = Reading;
+    Post(&e, QString("/ReadResponses/") + e.SessionID + QString("/"), QByteArray());
+}
+
+void JobScheduler::Finish(quint64 key, bool ok, QString message)
+{
+    if (!running.contains(key))
+        return;
+
+    Execution e = running.take(key);
+
+    if (e.Reply)
+    {
+        replies.remove(e.Reply);
+        disconnect(e.Reply, 0, this, 0);
+        e.Reply->abort();
+        e.Reply->deleteLater();
+    }
+
+    if (!e.SessionID.isEmpty())
+    {
+        QUrl url = e.Base;
+        url.setPath(QString("/CloseSession/"));
+        SessionManager::Instance()->CloseSession(url, e.SessionID, e.Name);
+    }
+
+    JobRun run;
+    run.Time = QDateTime::currentDateTime();
+    run.Connection = e.Name;
+    run.Ok = ok;
+    run.Message = message.left(200);
+
+    QList<JobRun> &log = runLog[e.Job];
+    log.append(run);
+    while (log.size() > MaxRunLog)
+        log.removeFirst();
+
+    emit RunFinished(e.Job);
+
+    StartRuns();
+}
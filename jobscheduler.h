@@ -0,0 +1,129 @@
+#ifndef JOBSCHEDULER_H
+#define JOBSCHEDULER_H
+
+#include <QObject>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QStringList>
+#include <QUrl>
+#include <QUuid>
+
+#include "jobdata.h"
+#include "timerwheel.h"
+
+class ConnectionModel;
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+// One run of a job on one connection, as kept in the run log
+struct JobRun
+{
+    QDateTime Time;
+    QString Connection;
+    bool Ok;
+    QString Message;
+};
+
+// Runs the scheduled jobs. Every job is due on every connection it
+// targets, and each of those pairs is one key in a timer wheel that a
+// single timer moves on once a second. The first run of a pair is put
+// off by an amount taken from the job and connection, so a job on many
+// servers doesn't hit them all in the same second.
+//
+// A run logs in on a session of its own, sends the command, reads the
+// output up to the next prompt and closes the session again.
+//
+// The scheduler owns the job records.
+class JobScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit JobScheduler(ConnectionModel *model, QObject *parent = 0);
+    ~JobScheduler();
+
+    void SetJobs(QList<JobData *> list);
+    QList<JobData *> Jobs() const;
+    JobData *Job(QUuid uuid) const;
+    void AddJob(JobData *job);
+    void Changed(QUuid uuid);
+    void RemoveJob(QUuid uuid);
+
+    QList<JobRun> RunLog(QUuid job) const;
+    int Scheduled() const;
+    int Running() const;
+
+signals:
+    void RunFinished(QUuid job);
+
+protected slots:
+    void Tick();
+    void Resync();
+    void ScheduleResync();
+    void Reply();
+
+protected:
+    enum Stage
+    {
+        Starting,
+        Sending,
+        Reading
+    };
+
+    typedef QPair<QUuid, QUuid> PairKey;
+
+    struct Plan
+    {
+        QUuid Job;
+        QUuid Connection;
+        int Interval;
+        qint64 Due;
+    };
+
+    struct Execution
+    {
+        quint64 Key;
+        QUuid Job;
+        QString Name;
+        QUrl Base;
+        QString SessionID;
+        int Stage;
+        qint64 Deadline;
+        QStringList Output;
+        bool Prompted;
+        int EmptyPolls;
+        QNetworkReply *Reply;
+    };
+
+    qint64 Seconds() const;
+    QList<QUuid> TargetsOf(JobData *job) const;
+    qint64 FirstDue(JobData *job, QUuid connection) const;
+    void StartRuns();
+    void Start(quint64 key);
+    void Post(Execution *e, QString path, QByteArray data);
+    void Finish(quint64 key, bool ok, QString message);
+
+    ConnectionModel *model;
+    QNetworkAccessManager *manager;
+    QTimer *tickTimer;
+    QTimer *resyncTimer;
+    QElapsedTimer clock;
+    TimerWheel wheel;
+
+    QList<JobData *> jobs;
+    QHash<PairKey, quint64> keys;
+    QHash<quint64, Plan> plans;
+    quint64 nextKey;
+
+    QList<quint64> waiting;
+    QHash<quint64, Execution> running;
+    QHash<QNetworkReply *, quint64> replies;
+
+    QHash<QUuid, QList<JobRun> > runLog;
+};
+
+#endif // JOBSCHEDULER_H
@@ -0,0 +1,204 @@
+#include "jobsdialog.h"
+#include "ui_jobsdialog.h"
+#include "jobscheduler.h"
+#include "connectionmodel.h"
+#include "connectiondata.h"
+#include "groupdata.h"
+
+#include <QListWidgetItem>
+
+#include <algorithm>
+
+JobsDialog::JobsDialog(JobScheduler *scheduler, ConnectionModel *model, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::JobsDialog),
+    scheduler(scheduler),
+    current(-1),
+    loading(false)
+{
+    ui->setupUi(this);
+
+    // Groups first, then the connections that aren't in one
+    ui->target->addItem(tr("All connections"), QVariant(QUuid().toString()));
+
+    QList<GroupData *> groups = model->Groups();
+    std::sort(groups.begin(), groups.end(), [](GroupData *a, GroupData *b) -> bool {
+        return a->Name.toLower() < b->Name.toLower();
+    });
+    foreach (GroupData *grp, groups)
+        ui->target->addItem(tr("Group %1").arg(grp->Name), QVariant(grp->Uuid.toString()));
+
+    QList<ConnectionData *> connections = model->Connections();
+    std::sort(connections.begin(), connections.end(), [](ConnectionData *a, ConnectionData *b) -> bool {
+        return a->Name.toLower() < b->Name.toLower();
+    });
+    foreach (ConnectionData *c, connections)
+    {
+        if (c->Group.isNull())
+            ui->target->addItem(c->Name, QVariant(c->Uuid.toString()));
+    }
+
+    foreach (JobData *job, scheduler->Jobs())
+    {
+        jobs.append(*job);
+
+        // A target that is gone is kept, not quietly turned into all
+        if (ui->target->findData(QVariant(job->Target.toString())) < 0)
+            ui->target->addItem(tr("(removed)"), QVariant(job->Target.toString()));
+
+        ui->jobList->addItem(Label(*job));
+    }
+
+    connect(ui->jobList, SIGNAL(currentRowChanged(int)), this, SLOT(Selected(int)));
+    connect(ui->name, SIGNAL(textEdited(QString)), this, SLOT(Edited()));
+    connect(ui->command, SIGNAL(textEdited(QString)), this, SLOT(Edited()));
+    connect(ui->interval, SIGNAL(valueChanged(int)), this, SLOT(Edited()));
+    connect(ui->target, SIGNAL(currentIndexChanged(int)), this, SLOT(Edited()));
+    connect(ui->enabled, SIGNAL(toggled(bool)), this, SLOT(Edited()));
+    connect(ui->addJob, SIGNAL(clicked()), this, SLOT(AddJob()));
+    connect(ui->removeJob, SIGNAL(clicked()), this, SLOT(RemoveJob()));
+    connect(scheduler, SIGNAL(RunFinished(QUuid)), this, SLOT(RunFinished(QUuid)));
+
+    connect(ui->buttonBox, SIGNAL(accepted()), this, SLOT(OnOK()));
+    connect(ui->buttonBox, SIGNAL(rejected()), this, SLOT(OnCancel()));
+
+    if (jobs.isEmpty())
+        Selected(-1);
+    else
+        ui->jobList->setCurrentRow(0);
+}
+
+JobsDialog::~JobsDialog()
+{
+    delete ui;
+}
+
+QList<JobData> JobsDialog::Jobs()
+{
+    return jobs;
+}
+
+QString JobsDialog::Label(const JobData &job)
+{
+    QString name = job.Name.isEmpty() ? job.Command : job.Name;
+
+    if (!job.Enabled)
+        name += tr(" (off)");
+
+    return name;
+}
+
+void JobsDialog::Selected(int row)
+{
+    current = row;
+
+    bool valid = row >= 0 && row < jobs.size();
+    ui->details->setEnabled(valid);
+    ui->removeJob->setEnabled(valid);
+
+    loading = true;
+
+    if (valid)
+    {
+        const JobData &job = jobs.at(row);
+
+        ui->name->setText(job.Name);
+        ui->command->setText(job.Command);
+        ui->interval->setValue(qMax(1, job.Interval / 60));
+        ui->target->setCurrentIndex(qMax(0, ui->target->findData(QVariant(job.Target.toString()))));
+        ui->enabled->setChecked(job.Enabled);
+    }
+    else
+    {
+        ui->name->clear();
+        ui->command->clear();
+        ui->enabled->setChecked(false);
+    }
+
+    loading = false;
+
+    ShowRunLog();
+}
+
+void JobsDialog::Edited()
+{
+    if (loading || current < 0 || current >= jobs.size())
+        return;
+
+    JobData &job = jobs[current];
+
+    job.Name = ui->name->text();
+    job.Command = ui->command->text();
+    job.Interval = ui->interval->value() * 60;
+    job.Target = QUuid(ui->target->currentData().toString());
+    job.Enabled = ui->enabled->isChecked();
+
+    ui->jobList->item(current)->setText(Label(job));
+}
+
+void JobsDialog::AddJob()
+{
+    JobData job;
+    job.Uuid = QUuid::createUuid();
+    job.Interval = ui->interval->minimum() * 60;
+
+    jobs.append(job);
+    ui->jobList->addItem(Label(job));
+    ui->jobList->setCurrentRow(jobs.size() - 1);
+
+    ui->command->setFocus();
+}
+
+void JobsDialog::RemoveJob()
+{
+    if (current < 0 || current >= jobs.size())
+        return;
+
+    int row = current;
+
+    jobs.removeAt(row);
+    delete ui->jobList->takeItem(row);
+
+    Selected(ui->jobList->currentRow());
+}
+
+void JobsDialog::RunFinished(QUuid job)
+{
+    if (current >= 0 && current < jobs.size() && jobs.at(current).Uuid == job)
+        ShowRunLog();
+}
+
+// Newest run first
+void JobsDialog::ShowRunLog()
+{
+    ui->runLog->clear();
+
+    if (current < 0 || current >= jobs.size())
+        return;
+
+    QList<JobRun> runs = scheduler->RunLog(jobs.at(current).Uuid);
+
+    QStringList text;
+    for (int i = runs.size() - 1 ; i >= 0 ; i--)
+    {
+        const JobRun &run = runs.at(i);
+
+        text.append(QString("%1  %2  %3  %4")
+                    .arg(run.Time.toString("yyyy-MM-dd HH:mm:ss"))
+                    .arg(run.Connection)
+                    .arg(run.Ok ? tr("OK") : tr("Failed"))
+                    .arg(run.Message));
+    }
+
+    ui->runLog->setPlainText(text.join("\n"));
+}
+
+void JobsDialog::OnOK()
+{
+    done(0);
+}
+
+void JobsDialog::OnCancel()
+{
+    done(-1);
+}
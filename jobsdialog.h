@@ -0,0 +1,49 @@
+#ifndef JOBSDIALOG_H
+#define JOBSDIALOG_H
+
+#include <QDialog>
+#include <QList>
+#include <QUuid>
+
+#include "jobdata.h"
+
+class JobScheduler;
+class ConnectionModel;
+
+namespace Ui {
+class JobsDialog;
+}
+
+// Edits a copy of the scheduled jobs. The caller takes the list back
+// with Jobs() once the dialog is accepted.
+class JobsDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit JobsDialog(JobScheduler *scheduler, ConnectionModel *model, QWidget *parent = 0);
+    ~JobsDialog();
+
+    QList<JobData> Jobs();
+
+protected slots:
+    void OnOK();
+    void OnCancel();
+    void Selected(int row);
+    void Edited();
+    void AddJob();
+    void RemoveJob();
+    void RunFinished(QUuid job);
+
+protected:
+    void ShowRunLog();
+    QString Label(const JobData &job);
+
+    Ui::JobsDialog *ui;
+    JobScheduler *scheduler;
+    QList<JobData> jobs;
+    int current;
+    bool loading;
+};
+
+#endif // JOBSDIALOG_H
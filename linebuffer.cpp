@@ -0,0 +1,126 @@
+#include "linebuffer.h"
+
+quint8 ConsoleLine::LevelOf(QString level)
+{
+    if (level == QString("error"))
+        return Error;
+    if (level == QString("warn"))
+        return Warn;
+    if (level == QString("command"))
+        return Command;
+
+    return Normal;
+}
+
+QString ConsoleLine::LevelName(quint8 level)
+{
+    switch (level)
+    {
+    case Error:
+        return QString("error");
+    case Warn:
+        return QString("warn");
+    case Command:
+        return QString("command");
+    }
+
+    return QString();
+}
+
+LineBuffer::LineBuffer(int capacity) :
+    head(0),
+    count(0),
+    nextSeq(0)
+{
+    ring.resize(capacity > 0 ? capacity : 1);
+}
+
+quint64 LineBuffer::Append(QString text, quint8 level, qint64 time)
+{
+    int slot = (head + count) % ring.size();
+    if (count == ring.size())
+        head = (head + 1) % ring.size();
+    else
+        count++;
+
+    ConsoleLine &line = ring[slot];
+    line.Time = time;
+    line.Seq = nextSeq;
+    line.Text = text;
+    line.Level = level;
+
+    return nextSeq++;
+}
+
+// Sequence numbers go on where they were, readers see the lines as gone
+void LineBuffer::Clear()
+{
+    for (int i = 0 ; i < count ; i++)
+        ring[(head + i) % ring.size()].Text = QString();
+
+    head = 0;
+    count = 0;
+}
+
+// Drop the oldest lines until at most keep are left, returns how many
+// went. The capacity stays, the buffer fills up again as lines come.
+int LineBuffer::Shrink(int keep)
+{
+    int drop = count - qMax(0, keep);
+    if (drop <= 0)
+        return 0;
+
+    for (int i = 0 ; i < drop ; i++)
+        ring[(head + i) % ring.size()].Text = QString();
+
+    head = (head + drop) % ring.size();
+    count -= drop;
+
+    return drop;
+}
+
+// Roughly what the buffer takes up, for the memory accounting
+qint64 LineBuffer::Bytes() const
+{
+    qint64 bytes = ring.capacity() * sizeof(ConsoleLine);
+
+    for (int i = 0 ; i < count ; i++)
+        bytes += 24 + At(i).Text.capacity() * 2;
+
+    return bytes;
+}
+
+int LineBuffer::Count() const
+{
+    return count;
+}
+
+int LineBuffer::Capacity() const
+{
+    return ring.size();
+}
+
+// 0 is the oldest line kept
+const ConsoleLine &LineBuffer::At(int i) const
+{
+    return ring.at((head + i) % ring.size());
+}
+
+quint64 LineBuffer::FirstSeq() const
+{
+    return nextSeq - count;
+}
+
+quint64 LineBuffer::NextSeq() const
+{
+    return nextSeq;
+}
+
+// Where a line is now, or -1 if it was dropped or hasn't come yet
+int LineBuffer::IndexOf(quint64 seq) const
+{
+    if (seq < FirstSeq() || seq >= nextSeq)
+        return -1;
+
+    return int(seq - FirstSeq());
+}
@@ -0,0 +1,57 @@
+#ifndef LINEBUFFER_H
+#define LINEBUFFER_H
+
+#include <QString>
+#include <QVector>
+
+// One line of console output as it came from the simulator
+struct ConsoleLine
+{
+    enum Level
+    {
+        Normal,
+        Command,
+        Warn,
+        Error
+    };
+
+    // Arrival time in ms since the epoch, and the position in the
+    // session's output
+    qint64 Time;
+    quint64 Seq;
+    QString Text;
+    quint8 Level;
+
+    static quint8 LevelOf(QString level);
+    static QString LevelName(quint8 level);
+};
+
+// The most recent lines of a session's output, oldest first. When it
+// is full, the oldest line makes room for the new one. Sequence numbers
+// keep counting, so a reader can tell which lines it has already seen
+// and which ones it missed.
+class LineBuffer
+{
+public:
+    explicit LineBuffer(int capacity = 4096);
+
+    quint64 Append(QString text, quint8 level, qint64 time);
+    void Clear();
+    int Shrink(int keep);
+
+    int Count() const;
+    int Capacity() const;
+    const ConsoleLine &At(int i) const;
+    quint64 FirstSeq() const;
+    quint64 NextSeq() const;
+    int IndexOf(quint64 seq) const;
+    qint64 Bytes() const;
+
+protected:
+    QVector<ConsoleLine> ring;
+    int head;
+    int count;
+    quint64 nextSeq;
+};
+
+#endif // LINEBUFFER_H
@@ -1,9 +1,120 @@
 #include "mainwindow.h"
+#include "startuptimeline.h"
+#include "connectiondata.h"
+#include "connectionpane.h"
+#include "panepool.h"
+#include "alertmatcher.h"
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+
+// Build panes from scratch, then the same number through the pool, and
+// report how long each took
+static int benchPanes(int count)
+{
+    QTextStream out(stdout);
+
+    ConnectionData c;
+    c.Name = QString("Bench");
+    c.Host = QString("127.0.0.1");
+    c.Port = 9000;
+
+    QElapsedTimer timer;
+    QList<ConnectionPane *> panes;
+
+    timer.start();
+    for (int i = 0 ; i < count ; i++)
+        panes.append(new ConnectionPane(&c, QHostAddress()));
+    qint64 cold = timer.elapsed();
+
+    qDeleteAll(panes);
+    panes.clear();
+
+    // Fill the pool once, then time taking and recycling
+    for (int i = 0 ; i < 8 ; i++)
+        PanePool::Instance()->Recycle(new ConnectionPane());
+
+    timer.restart();
+    for (int i = 0 ; i < count ; i++)
+    {
+        ConnectionPane *pane = PanePool::Instance()->Take(&c, QHostAddress(), 0);
+        PanePool::Instance()->Recycle(pane);
+    }
+    qint64 pooled = timer.elapsed();
+
+    out << "Created " << count << " panes in " << cold << " ms" << endl;
+    out << "Reused " << count << " panes in " << pooled << " ms" << endl;
+
+    return 0;
+}
+
+// Match made up console lines against a typical set of rules, on one
+// thread, and report the rate
+static int benchAlerts(int count)
+{
+    QTextStream out(stdout);
+
+    QList<AlertRule> rules;
+    rules << AlertRule::Parse("Exception") << AlertRule::Parse("deadlock")
+          << AlertRule::Parse("out of memory") << AlertRule::Parse("/thread \\d+ blocked/")
+          << AlertRule::Parse("/login failed for .* from/");
+
+    AlertMatcher matcher(rules);
+
+    QStringList templates;
+    templates << "[SCENE]: Region Sandbox%1 ready, %1 prims in %1 ms"
+              << "[LLUDPSERVER]: Client %1 logged in to Sandbox%1"
+              << "[ASSET SERVICE]: Asset %1 not found"
+              << "[SCENE]: Exception in Update loop at frame %1"
+              << "[WATCHDOG]: thread %1 blocked for 5000 ms"
+              << "[LOGIN SERVICE]: Login failed for avatar%1 from 10.0.0.%1";
+
+    QStringList lines;
+    for (int i = 0 ; i < 1000 ; i++)
+        lines.append(templates.at(i % templates.size()).arg(i * 7919));
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int matched = 0;
+    for (int i = 0 ; i < count ; i++)
+        matched += matcher.Match(lines.at(i % lines.size())).size();
+
+    qint64 elapsed = timer.elapsed();
+
+    out << "Matched " << count << " lines in " << elapsed << " ms, "
+        << (elapsed > 0 ? qint64(count) * 1000 / elapsed : 0) << " lines/s, "
+        << matched << " alerts" << endl;
+
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    StartupTimeline::Start();
+
     QApplication a(argc, argv);
+    StartupTimeline::Mark("Application created");
+
+    QStringList args = a.arguments();
+    int bench = args.indexOf("--bench-panes");
+    if (bench >= 0)
+    {
+        QCoreApplication::setOrganizationName("OpenSimulator");
+        QCoreApplication::setApplicationName("OpenSim Console Client");
+
+        int count = args.value(bench + 1).toInt();
+        return benchPanes(count > 0 ? count : 500);
+    }
+
+    bench = args.indexOf("--bench-alerts");
+    if (bench >= 0)
+    {
+        int count = args.value(bench + 1).toInt();
+        return benchAlerts(count > 0 ? count : 1000000);
+    }
+
     MainWindow w;
     w.show();
 
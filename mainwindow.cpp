@@ -3,146 +3,196 @@
 #include "connectiondata.h"
 #include "groupdata.h"
 #include "connectionpane.h"
+#include "sessionmanager.h"
+#include "connectionmodel.h"
+#include "connectionfilter.h"
+#include "connectionstore.h"
+#include "memberlistloader.h"
+#include "membercache.h"
+#include "startuptimeline.h"
+#include "healthprober.h"
+#include "jobscheduler.h"
+#include "panetheme.h"
+#include "panepool.h"
+#include "dashboardview.h"
+#include "mergedlogview.h"
+#include "memoryview.h"
+#include "memorybudget.h"
+#include "alertengine.h"
+#include "metricextractor.h"
 #include <QSettings>
 #include <QMessageBox>
 #include <QLineEdit>
 #include <QSpinBox>
-#include <QTreeWidget>
-#include <QTreeWidgetItem>
-#include <QTreeWidgetItemIterator>
+#include <QTreeView>
+#include <QItemSelectionModel>
 #include <QDnsLookup>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QShowEvent>
+#include <QCloseEvent>
+#include <QStatusBar>
+#include <QFileDialog>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+#include <QDateTime>
+#include <QFont>
+#include <QTabBar>
+#include <QSystemTrayIcon>
+#include <QApplication>
 
 #include "addconndialog.h"
 #include "addgroupdialog.h"
 #include "preferencesdialog.h"
+#include "jobsdialog.h"
 #include "ui_preferencesdialog.h"
 #include "splashdialog.h"
 
-enum ItemType
-{
-    GroupItem = QTreeWidgetItem::UserType,
-    ConnectionItem = QTreeWidgetItem::UserType + 1
-};
+#include <algorithm>
 
 MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
+    started(false),
     ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
 
     manager = new QNetworkAccessManager(this);
 
-    ui->connList->setColumnCount(1);
-    ui->connList->setHeaderLabel("Connections");
+    // The tree view shows the connection model sorted by name and
+    // narrowed down by the filter box
+    model = new ConnectionModel(this);
+    proxy = new ConnectionFilterModel(model, this);
+
+    ui->connList->setModel(proxy);
     ui->connList->setHeaderHidden(true);
-    ui->connList->sortByColumn(0, Qt::AscendingOrder);
     ui->connList->setContextMenuPolicy(Qt::CustomContextMenu);
 
     connect (ui->consolePane, SIGNAL(tabCloseRequested(int)), this, SLOT(CloseTab(int)));
     connect (ui->connList, SIGNAL(customContextMenuRequested(const QPoint &)), this, SLOT(ConnContext(const QPoint &)));
-    connect(ui->connList, SIGNAL(itemDoubleClicked(QTreeWidgetItem *, int)), this, SLOT(ConnectionDoubleClicked(QTreeWidgetItem *, int)));
-    connect(ui->connList, SIGNAL(itemChanged(QTreeWidgetItem*,int)), this, SLOT(treeWidgetItemChanged(QTreeWidgetItem*,int)));
+    connect(ui->connList, SIGNAL(doubleClicked(const QModelIndex &)), this, SLOT(ConnectionDoubleClicked(const QModelIndex &)));
+    connect(model, SIGNAL(Renamed(QUuid)), this, SLOT(itemRenamed(QUuid)));
+    connect(ui->filterEdit, SIGNAL(textChanged(const QString &)), this, SLOT(filterChanged(const QString &)));
+    connect(ui->filterEdit, SIGNAL(returnPressed()), this, SLOT(filterReturnPressed()));
+
+    store = new ConnectionStore(this);
 
     QCoreApplication::setOrganizationName("OpenSimulator");
     QCoreApplication::setApplicationName("OpenSim Console Client");
 
     QSettings settings;
 
-    ui->connList->blockSignals(true);
-
     restoreGeometry(settings.value("mainWindowGeometry").toByteArray());
     restoreState(settings.value("mainWindowState").toByteArray());
 
     blackOnWhite = settings.value("black_on_white", QVariant(true)).toBool();
     systemFont = settings.value("system_font", QVariant(false)).toBool();
+    idleTimeout = settings.value("idle_timeout", QVariant(0)).toInt();
+
+    SessionManager::Instance()->SetIdleTimeout(idleTimeout);
+    connect(SessionManager::Instance(), SIGNAL(Report(QString)), this, SLOT(sessionReport(QString)));
+
+    memoryBudget = settings.value("memory_budget", QVariant(1024)).toInt();
+    MemoryBudget::Instance()->SetBudget(memoryBudget);
+    connect(MemoryBudget::Instance(), SIGNAL(Reclaimed(QString)), this, SLOT(sessionReport(QString)));
+
+    alertRules = settings.value("alert_rules", QStringList() << "Exception" << "deadlock" << "out of memory").toStringList();
+    alertTray = settings.value("alert_tray", QVariant(true)).toBool();
+    alertTab = settings.value("alert_tab", QVariant(true)).toBool();
+    alertSound = settings.value("alert_sound", QVariant(false)).toBool();
+    tray = 0;
+
+    applyAlertRules();
+
+    metricRules = settings.value("metric_extractors", MetricExtractor::DefaultRules()).toStringList();
+    MetricExtractor::SetRules(metricRules);
+
+    connect(AlertEngine::Instance(), SIGNAL(Alert(ConnectionPane *, QString, QString)), this, SLOT(alertRaised(ConnectionPane *, QString, QString)));
+    connect(ui->consolePane, SIGNAL(currentChanged(int)), this, SLOT(tabChanged(int)));
 
     if (settings.value("split").isValid())
         ui->splitter->restoreState(settings.value("split").toByteArray());
 
-    int groupCount = settings.beginReadArray(QString("Groups"));
-    for (int i = 0 ; i < groupCount ; i++)
-    {
-        settings.setArrayIndex(i);
+    refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(60000);
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(refreshGroups()));
 
-        GroupData *grp = new GroupData();
+    prober = new HealthProber(this);
+    connect(prober, SIGNAL(StatusChanged(QUuid, int)), model, SLOT(SetStatus(QUuid, int)));
+    connect(prober, SIGNAL(SweepDue()), this, SLOT(startSweep()));
+    connect(prober, SIGNAL(SweepDone(int, int, qint64)), this, SLOT(sweepDone(int, int, qint64)));
 
-        grp->Name = settings.value("Name").toString();
-        grp->Uuid = settings.value("Uuid").toUuid();
-        grp->Dynamic = settings.value("Dynamic", QVariant(false)).toBool();
-        grp->Source = settings.value("Source", QVariant("")).toString();
-        grp->User = settings.value("User", QVariant("")).toString();
-        grp->Pass = settings.value("Pass", QVariant("")).toString();
+    ui->action_Health->setChecked(settings.value("health_probe", QVariant(true)).toBool());
+    prober->SetEnabled(ui->action_Health->isChecked());
+    connect(ui->action_Health, SIGNAL(toggled(bool)), this, SLOT(healthToggled(bool)));
 
-        QVariant dnsAddress = settings.value("Dns");
-        if (dnsAddress.isValid())
-            grp->Dns = QHostAddress(dnsAddress.toString());
+    scheduler = new JobScheduler(model, this);
 
-        groups[grp->Uuid] = grp;
+    StartupTimeline::Mark("Main window created");
+}
 
-        insertGroup(grp);
+// Runs once the window is up. Dynamic groups show their cached members
+// and are only fetched once they can be seen.
+void MainWindow::loadConnections()
+{
+    QList<GroupData *> loadedGroups;
+    QList<ConnectionData *> loadedConnections;
+    QList<JobData *> loadedJobs;
+
+    store->Load(&loadedGroups, &loadedConnections, &loadedJobs);
 
-        QTreeWidgetItem *grpItem = findItem(grp->Uuid);
+    if (store->IsReadOnly())
+        QMessageBox::warning(this, QString("Connection list"),
+            QString("The saved connection list could not be read completely. "
+                    "Changes will not be saved until it is repaired or removed."));
 
-        if (settings.value("Expanded").toBool())
-            grpItem->setExpanded(true);
+    StartupTimeline::Mark("Connection store read");
 
+    foreach (GroupData *grp, loadedGroups)
+    {
         if (grp->Dynamic)
-            loadGroup(grpItem);
+            MemberCache::Instance()->Restore(grp, &loadedConnections);
     }
-    settings.endArray();
 
-    int connCount = settings.beginReadArray(QString("Connections"));
+    StartupTimeline::Mark("Cached members restored");
 
-    for (int i = 0 ; i < connCount ; i++)
-    {
-        settings.setArrayIndex(i);
+    // One model reset for the whole list
+    model->Load(loadedGroups, loadedConnections);
 
-        ConnectionData *c = new ConnectionData;
+    StartupTimeline::Mark("Tree populated");
 
-        c->Name = settings.value("Name").toString();
-        c->Host = settings.value("Host").toString();
-        c->Port = settings.value("Port").toInt();
-        c->User = settings.value("User").toString();
-        c->Pass = settings.value("Pass").toString();
-        c->Uuid = settings.value("Uuid").toUuid();
-        c->Dynamic = false;
+    foreach (GroupData *grp, loadedGroups)
+    {
+        if (!grp->Expanded)
+            continue;
 
-        connections[c->Uuid] = c;
+        ui->connList->setExpanded(proxy->mapFromSource(model->IndexOf(grp->Uuid)), true);
+        if (grp->Dynamic)
+            loadGroup(grp->Uuid);
+    }
 
-        QTreeWidgetItem *connItem;
+    connect(ui->connList, SIGNAL(expanded(const QModelIndex &)), this, SLOT(groupExpanded(const QModelIndex &)));
+    connect(ui->connList, SIGNAL(collapsed(const QModelIndex &)), this, SLOT(groupExpanded(const QModelIndex &)));
 
-        QUuid parent = settings.value("Parent").toUuid();
-        if (!parent.isNull())
-        {
-            QTreeWidgetItem *parentItem = findItem(parent);
-            if (parentItem == 0)
-                continue;
+    refreshTimer->start();
 
-            connItem = new QTreeWidgetItem(parentItem, QStringList(QString(c->Name)), ConnectionItem);
-        }
-        else
-        {
-            connItem = new QTreeWidgetItem(ui->connList, QStringList(QString(c->Name)), ConnectionItem);
-        }
+    if (ui->action_Health->isChecked())
+        startSweep();
 
-        connItem->setIcon(0, QIcon(":/Icons/computer.png"));
-        connItem->setData(0, Qt::UserRole, c->Uuid);
-        connItem->setFlags(connItem->flags() | Qt::ItemIsEditable);
-    }
-    settings.endArray();
+    scheduler->SetJobs(loadedJobs);
 
-    ui->connList->blockSignals(false);
+    // The first tabs opened don't have to build a pane
+    PanePool::Instance()->Prewarm(2);
 
-    ui->connList->sortItems(0, Qt::AscendingOrder);
+    StartupTimeline::Finish();
 }
 
 MainWindow::~MainWindow()
 {
     WriteSettings();
+    store->Flush();
 
     // No need to free anything as the OS does it for us
 
@@ -153,61 +203,75 @@ void MainWindow::showEvent(QShowEvent *event)
 {
     if (!event->spontaneous())
     {
+        if (!started)
+        {
+            started = true;
+            StartupTimeline::Mark("Window shown");
+            QTimer::singleShot(0, this, SLOT(loadConnections()));
+        }
+
         SplashDialog *dlg = new SplashDialog(this, Qt::SplashScreen);
         dlg->isSplash = true;
         dlg->show();
     }
 }
 
+void MainWindow::closeEvent(QCloseEvent *event)
+{
+    // Give the simulators a moment to drop our sessions
+    SessionManager::Instance()->CloseAll(2000);
+
+    QMainWindow::closeEvent(event);
+}
+
+void MainWindow::sessionReport(QString message)
+{
+    statusBar()->showMessage(message, 10000);
+}
+
 void MainWindow::on_action_Exit_triggered()
 {
     close();
 }
 
+static bool connectionLessThan(ConnectionData *a, ConnectionData *b)
+{
+    return a->Name < b->Name;
+}
+
 void MainWindow::on_action_Connect_triggered()
 {
-    QTreeWidgetItem *item = selectedItem();
-    if (!item)
+    QModelIndex index = selectedIndex();
+    if (!index.isValid())
         return;
 
-    if (item->type() == GroupItem) // Group
-    {
-        QUuid groupUuid = item->data(0, Qt::UserRole).toUuid();
+    QUuid uuid = model->UuidOf(index);
 
-        if (!groups.contains(groupUuid))
+    if (model->TypeOf(index) == GroupItem) // Group
+    {
+        GroupData *grp = model->Group(uuid);
+        if (!grp)
             return;
 
-        for (int i = 0 ; i < item->childCount() ; i ++)
-        {
-            QTreeWidgetItem *it = item->child(i);
-
-            QUuid uuid = it->data(0, Qt::UserRole).toUuid();
-
-            if (!connections.contains(uuid))
-                continue;
+        // Open the tabs in the order they are listed
+        QList<ConnectionData *> members = model->Members(uuid);
+        std::sort(members.begin(), members.end(), connectionLessThan);
 
-            AddNewTab(groups[groupUuid], connections[uuid], groups[groupUuid]->Dns);
-        }
+        foreach (ConnectionData *c, members)
+            AddNewTab(grp, c, grp->Dns);
         return;
     }
 
-    QUuid uuid = item->data(0, Qt::UserRole).toUuid();
-
-    if (!connections.contains(uuid))
+    ConnectionData *c = model->Connection(uuid);
+    if (!c)
         return;
 
-    ConnectionData *c = connections[uuid];
-
     QHostAddress dns;
 
-    if (item->parent() != 0)
-    {
-        QTreeWidgetItem *parentItem = item->parent();
-        QUuid parentUuid = parentItem->data(0, Qt::UserRole).toUuid();
+    GroupData *parentGroup = model->Group(c->Group);
+    if (parentGroup)
+        dns = parentGroup->Dns;
 
-        if (groups.contains(parentUuid))
-            dns = groups[parentUuid]->Dns;
-    }
     AddNewTab(0, c, dns);
 }
 
@@ -217,35 +281,34 @@ void MainWindow::on_action_Disconnect_triggered()
     if (!cw)
         return;
 
-    cw->CloseConnection();
-
     QTabWidget *p = (QTabWidget *)cw->parent()->parent();
 
     QWidget *pp = (QWidget *)p->parent()->parent();
 
     if (pp && pp->inherits("QTabWidget") && p->count() == 1)
     {
-        delete cw;
+        PanePool::Instance()->Recycle(cw);
         delete p;
     }
     else
     {
-        delete cw;
+        PanePool::Instance()->Recycle(cw);
     }
+
+    updateSessionViews();
 }
 
 void MainWindow::on_action_Edit_triggered()
 {
-    QTreeWidgetItem *item = selectedItem();
-    if (item == 0)
+    QModelIndex index = selectedIndex();
+    if (!index.isValid())
         return;
 
-    QUuid uuid = item->data(0, Qt::UserRole).toUuid();
+    QUuid uuid = model->UuidOf(index);
 
-    if (connections.contains(uuid))
+    ConnectionData *c = model->Connection(uuid);
+    if (c)
     {
-        ConnectionData *c = connections[uuid];
-
         AddConnDialog dlg(this);
 
         dlg.Name->setEnabled(false);
@@ -262,12 +325,14 @@ void MainWindow::on_action_Edit_triggered()
         c->Port = dlg.Port->value();
         c->User = dlg.User->text();
         c->Pass = dlg.Pass->text();
+
+        model->Changed(uuid);
+        store->Changed(c);
     }
 
-    if (groups.contains(uuid))
+    GroupData *g = model->Group(uuid);
+    if (g)
     {
-        GroupData *g = groups[uuid];
-
         AddGroupDialog dlg(this);
 
         dlg.Name->setEnabled(false);
@@ -277,6 +342,7 @@ void MainWindow::on_action_Edit_triggered()
         dlg.Source->setText(g->Source);
         dlg.User->setText(g->User);
         dlg.Pass->setText(g->Pass);
+        dlg.Refresh->setValue(g->RefreshInterval);
 
         if (dlg.exec() < 0)
             return;
@@ -293,16 +359,31 @@ void MainWindow::on_action_Edit_triggered()
         if (g->Dynamic && (dlg.Source->text() != g->Source))
             reload = true;
 
+        // New credentials are handed to the members by a refresh
+        bool refresh = false;
+        if (dlg.User->text() != g->User || dlg.Pass->text() != g->Pass)
+            refresh = true;
+
         g->Dynamic = dlg.Dynamic->isChecked();
         g->Source = dlg.Source->text();
         g->User = dlg.User->text();
         g->Pass = dlg.Pass->text();
+        g->RefreshInterval = dlg.Refresh->value();
+
+        model->Changed(uuid);
+        store->Changed(g);
 
         if (reload)
-            reloadGroup(item);
+        {
+            reloadGroup(uuid);
+        }
+        else if (refresh && g->Dynamic)
+        {
+            g->ETag.clear();
+            g->LastModified.clear();
+            loadGroup(uuid);
+        }
     }
-
-    WriteSettings();
 }
 
 void MainWindow::on_action_Restart_triggered()
@@ -369,7 +450,7 @@ void MainWindow::AddNewTab(GroupData *grp, ConnectionData *conn, QHostAddress ad
         if (c->IsLoggedIn())
             return;
 
-        delete c;
+        PanePool::Instance()->Recycle(c);
     }
 
     // If this is a group pane being opened, see if there is already
@@ -384,6 +465,7 @@ void MainWindow::AddNewTab(GroupData *grp, ConnectionData *conn, QHostAddress ad
             parent->setTabPosition(QTabWidget::North);
             parent->setTabShape(QTabWidget::Triangular);
             parent->setProperty("UUID", QVariant(grp->Uuid));
+            connect(parent, SIGNAL(currentChanged(int)), this, SLOT(tabChanged(int)));
             ui->consolePane->addTab(parent, grp->Name);
             ui->consolePane->setCurrentWidget(parent);
         }
@@ -393,7 +475,7 @@ void MainWindow::AddNewTab(GroupData *grp, ConnectionData *conn, QHostAddress ad
         }
     }
 
-    ConnectionPane *tabContents = new ConnectionPane(conn, addr, parent);
+    ConnectionPane *tabContents = PanePool::Instance()->Take(conn, addr, parent);
     tabContents->setVisible(true);
     tabContents->setProperty("UUID", conn->Uuid);
 
@@ -401,91 +483,33 @@ void MainWindow::AddNewTab(GroupData *grp, ConnectionData *conn, QHostAddress ad
     parent->setCurrentWidget(tabContents);
 
     tabContents->Login();
+
+    updateSessionViews();
 }
 
+// Window state and preferences. The connection list is saved by the
+// store as it changes.
 void MainWindow::WriteSettings()
 {
     QSettings settings;
 
-    settings.clear();
-
     settings.setValue("mainWindowGeometry", saveGeometry());
     settings.setValue("mainWindowState", saveState());
     settings.setValue("split", ui->splitter->saveState());
 
     settings.setValue("black_on_white", blackOnWhite);
     settings.setValue("system_font", systemFont);
-
-    settings.beginWriteArray(QString("Groups"), groups.count());
-
-    int idx = 0;
-    for (QMap<QUuid, GroupData *>::iterator it = groups.begin() ; it != groups.end() ; it++, idx++)
-    {
-        QTreeWidgetItem *grpItem = findItem((*it)->Uuid);
-
-        if (grpItem == 0)
-            continue;
-
-        settings.setArrayIndex(idx);
-        settings.setValue("Uuid", QVariant((*it)->Uuid));
-        settings.setValue("Name", QVariant((*it)->Name));
-        if (!(*it)->Dns.isNull())
-            settings.setValue("Dns", (*it)->Dns.toString());
-        settings.setValue("Expanded", QVariant(grpItem->isExpanded()));
-        settings.setValue("Dynamic", QVariant((*it)->Dynamic));
-        settings.setValue("Source", QVariant((*it)->Source));
-        settings.setValue("User", QVariant((*it)->User));
-        settings.setValue("Pass", QVariant((*it)->Pass));
-    }
-
-    settings.endArray();
-
-    settings.beginWriteArray(QString("Connections"));
-
-    idx = 0;
-    for (QMap<QUuid, ConnectionData *>::iterator it = connections.begin() ; it != connections.end() ; it++, idx++)
-    {
-        QUuid parent;
-
-        if ((*it)->Dynamic)
-            continue;
-
-        if (!(*it)->Uuid.isNull())
-        {
-            QTreeWidgetItem *item = findItem((*it)->Uuid);
-            if (item == 0)
-                continue;
-
-            if (item->parent() != 0)
-            {
-                parent = item->parent()->data(0, Qt::UserRole).toUuid();
-
-                // Check for a dynamic group. We don't save those connections
-                if (groups.contains(parent))
-                {
-                    if (groups[parent]->Dynamic)
-                        continue;
-                }
-            }
-            settings.setArrayIndex(idx);
-            settings.setValue("Uuid", QVariant((*it)->Uuid));
-            settings.setValue("Name", QVariant((*it)->Name));
-            settings.setValue("Host", QVariant((*it)->Host));
-            settings.setValue("Port", QVariant((*it)->Port));
-            settings.setValue("User", QVariant((*it)->User));
-            settings.setValue("Pass", QVariant((*it)->Pass));
-            settings.setValue("Parent", (QVariant(parent)));
-        }
-        else
-        {
-            idx--;
-        }
-    }
-
-    settings.endArray();
+    settings.setValue("idle_timeout", idleTimeout);
+    settings.setValue("memory_budget", memoryBudget);
+    settings.setValue("alert_rules", alertRules);
+    settings.setValue("alert_tray", alertTray);
+    settings.setValue("alert_tab", alertTab);
+    settings.setValue("alert_sound", alertSound);
+    settings.setValue("metric_extractors", metricRules);
+    settings.setValue("health_probe", ui->action_Health->isChecked());
 }
 
-void MainWindow::ConnectionDoubleClicked(QTreeWidgetItem *, int)
+void MainWindow::ConnectionDoubleClicked(const QModelIndex &)
 {
     ui->action_Connect->trigger();
 }
@@ -513,29 +537,29 @@ ConnectionPane * MainWindow::GetCurrentTab()
 
 void MainWindow::ConnContext(const QPoint &pos)
 {
-    QTreeWidgetItem *item = ui->connList->itemAt(pos);
+    QModelIndex viewIndex = ui->connList->indexAt(pos);
     ui->connList->clearSelection();
-    if (item)
-        item->setSelected(true);
+    if (viewIndex.isValid())
+        ui->connList->selectionModel()->select(viewIndex, QItemSelectionModel::Select);
+
+    QModelIndex index = proxy->mapToSource(viewIndex);
 
     QMenu ctx("Connection actions", this);
-    if (!item)
+    if (!index.isValid())
     {
         connect (ctx.addAction("Add ..."), SIGNAL(triggered()), this, SLOT(addRootConnection()));
         connect (ctx.addAction("Add Group..."), SIGNAL(triggered()), ui->actionNew_group, SLOT(trigger()));
     }
     else
     {
-        QUuid uuid = item->data(0, Qt::UserRole).toUuid();
+        QUuid uuid = model->UuidOf(index);
         if (uuid.isNull())
             return;
 
         // Connection items
-        if (item->type() == ConnectionItem)
+        if (model->TypeOf(index) == ConnectionItem)
         {
-            ConnectionData *conn = 0;
-            if (connections.contains(uuid))
-                conn = connections[uuid];
+            ConnectionData *conn = model->Connection(uuid);
 
             if (conn != 0)
             {
@@ -551,13 +575,11 @@ void MainWindow::ConnContext(const QPoint &pos)
             if (conn == 0 || (!conn->Dynamic))
                 connect (ctx.addAction("Delete"), SIGNAL(triggered()), ui->actionDelete, SLOT(trigger()));
         }
-        else if(item->type() == GroupItem)
+        else if(model->TypeOf(index) == GroupItem)
         {
-            GroupData *grp = 0;
-            if (groups.contains(uuid))
-                grp = groups[uuid];
+            GroupData *grp = model->Group(uuid);
 
-            if (grp && item->childCount() > 0)
+            if (grp && model->rowCount(index) > 0)
             {
                 connect (ctx.addAction("Connect Group"), SIGNAL(triggered()), ui->action_Connect, SLOT(trigger()));
                 ctx.addSeparator();
@@ -575,7 +597,7 @@ void MainWindow::ConnContext(const QPoint &pos)
                 }
             }
 
-            if (item->childCount() == 0 || (grp && grp->Dynamic))
+            if (model->rowCount(index) == 0 || (grp && grp->Dynamic))
                 connect (ctx.addAction("Delete"), SIGNAL(triggered()), ui->actionDelete_group, SLOT(trigger()));
         }
         ctx.addSeparator();
@@ -598,9 +620,7 @@ void MainWindow::CloseTab(int index)
         {
             ConnectionPane *c = (ConnectionPane *)tabs->widget(0);
 
-            c->CloseConnection();
-
-            delete c;
+            PanePool::Instance()->Recycle(c);
         }
 
         delete w;
@@ -608,14 +628,12 @@ void MainWindow::CloseTab(int index)
     else
     {
         if (w->inherits("ConnectionPane"))
-        {
-            ConnectionPane *c = (ConnectionPane *)w;
-
-            c->CloseConnection();
-        }
-
-        delete w;
+            PanePool::Instance()->Recycle((ConnectionPane *)w);
+        else
+            delete w;
     }
+
+    updateSessionViews();
 }
 
 void MainWindow::on_actionCopy_triggered()
@@ -627,78 +645,64 @@ void MainWindow::on_actionCopy_triggered()
     cw->Copy();
 }
 
-// Helper to get the selected item from the list.
-QTreeWidgetItem *MainWindow::selectedItem()
+// Helper to get the selected item from the list, as a model index.
+QModelIndex MainWindow::selectedIndex()
 {
-    QList<QTreeWidgetItem *> items = ui->connList->selectedItems();
+    QModelIndexList items = ui->connList->selectionModel()->selectedIndexes();
     if (items.count() != 1)
-        return 0;
+        return QModelIndex();
 
-    return items.at(0);
+    return proxy->mapToSource(items.at(0));
 }
 
-// User requests a new group to be created.
-void MainWindow::on_actionNew_group_triggered()
+// Select an item in the list and make sure it can be seen.
+void MainWindow::selectUuid(QUuid uuid)
 {
-    GroupData *grp= createGroup();
-
-    QTreeWidgetItem *item = insertGroup(grp);
+    QModelIndex viewIndex = proxy->mapFromSource(model->IndexOf(uuid));
 
-    ui->connList->editItem(item, 0);
+    ui->connList->clearSelection();
+    ui->connList->setCurrentIndex(viewIndex);
+    ui->connList->scrollTo(viewIndex);
 }
 
-// Insert a group into the tree view
-QTreeWidgetItem *MainWindow::insertGroup(GroupData *grp)
+// User requests a new group to be created.
+void MainWindow::on_actionNew_group_triggered()
 {
-    QTreeWidgetItem *item = new QTreeWidgetItem(ui->connList, QStringList(grp->Name), GroupItem);
-    item->setFlags(item->flags() | Qt::ItemIsEditable);
-    item->setData(0, Qt::UserRole, grp->Uuid);
-    item->setIcon(0, QIcon(":/Icons/folder.png"));
+    // The new group would not match
+    ui->filterEdit->clear();
 
-    ui->connList->sortItems(0, Qt::AscendingOrder);
+    GroupData *grp = createGroup();
 
-    return item;
+    ui->connList->edit(proxy->mapFromSource(model->IndexOf(grp->Uuid)));
 }
 
-// Create a new group record and insert it into the groups list.
-// Doesn't show or edit it.
+// Create a new group record and insert it into the model.
 GroupData *MainWindow::createGroup()
 {
     GroupData *grp = new GroupData();
 
-
     grp->Uuid = QUuid::createUuid();
     grp->Name = "New group";
     grp->Dynamic = false;
 
-    groups[grp->Uuid] = grp;
+    model->AddGroup(grp);
+    store->Changed(grp);
 
     return grp;
 }
 
-// Find any item in the list. Works for both groups and connections.
-QTreeWidgetItem *MainWindow::findItem(QUuid uuid)
-{
-    QTreeWidgetItemIterator it(ui->connList);
-
-    while (*it)
-    {
-        if ((*it)->data(0, Qt::UserRole).toUuid() == uuid)
-            return (*it);
-        it++;
-    }
-
-    return 0;
-}
-
 // Delete a group from the list
 void MainWindow::on_actionDelete_group_triggered()
 {
-    QTreeWidgetItem *item = selectedItem();
-    if (item == 0)
+    QModelIndex index = selectedIndex();
+    if (!index.isValid() || model->TypeOf(index) != GroupItem)
         return;
 
-    if (item->childCount() > 0 || item->type() != GroupItem)
+    QUuid uuid = model->UuidOf(index);
+    GroupData *grp = model->Group(uuid);
+
+    // Dynamic groups take their members with them
+    if (model->rowCount(index) > 0 && !(grp && grp->Dynamic))
         return;
 
     if (QMessageBox::question(0, QString("Delete group"),
@@ -707,30 +711,20 @@ void MainWindow::on_actionDelete_group_triggered()
             QMessageBox::Yes) != QMessageBox::Yes)
         return;
 
-    QUuid uuid = item->data(0, Qt::UserRole).toUuid();
-
-    if (groups.contains(uuid))
-    {
-        GroupData *grp = groups[uuid];
-        groups.remove(uuid);
-        delete grp;
-    }
-
-    delete item;
+    if (groupLoaders.contains(uuid))
+        groupLoaders.take(uuid)->Abort();
 
-    WriteSettings();
+    MemberCache::Instance()->Remove(uuid);
+    store->Removed(uuid);
+    model->Remove(uuid);
 }
 
 void MainWindow::on_action_New_triggered()
 {
-    QList<QTreeWidgetItem *>items = ui->connList->selectedItems();
-
-    if (items.count() == 0)
+    if (!selectedIndex().isValid())
         addRootConnection();
     else
         addChildConnection();
-
-    WriteSettings();
 }
 
 ConnectionData *MainWindow::createConnection()
@@ -748,8 +742,6 @@ ConnectionData *MainWindow::createConnection()
     c->Uuid = QUuid::createUuid();
     c->Dynamic = false;
 
-    connections[c->Uuid.toString()] = c;
-
     return c;
 }
 
@@ -760,26 +752,23 @@ void MainWindow::addRootConnection()
     if (c == 0)
         return;
 
-    QTreeWidgetItem *item = addItem(ui->connList, c);
-    if (!item)
-        connections.remove(c->Uuid);
+    c->Group = QUuid();
+    model->AddConnection(c);
+    store->Changed(c);
+
+    selectUuid(c->Uuid);
 }
 
 void MainWindow::addChildConnection()
 {
-    QTreeWidgetItem *parent = selectedItem();
+    QModelIndex parent = selectedIndex();
 
-    if (parent == 0)
+    if (!parent.isValid() || model->TypeOf(parent) != GroupItem)
         return;
 
-    if (parent->type() != GroupItem)
-        return;
-
-    QUuid uuid = parent->data(0, Qt::UserRole).toUuid();
-    if (!groups.contains(uuid))
-        return;
-    GroupData *g = groups[uuid];
-    if (g->Dynamic)
+    QUuid uuid = model->UuidOf(parent);
+    GroupData *g = model->Group(uuid);
+    if (g == 0 || g->Dynamic)
         return;
 
     ConnectionData *c = createConnection();
@@ -787,77 +776,134 @@ void MainWindow::addChildConnection()
     if (c == 0)
         return;
 
-    QTreeWidgetItem *item = addItem(parent, c);
-    if (!item)
-        connections.remove(c->Uuid);
+    c->Group = uuid;
+    model->AddConnection(c);
+    store->Changed(c);
+
+    ui->connList->setExpanded(proxy->mapFromSource(parent), true);
+    selectUuid(c->Uuid);
 }
 
-void MainWindow::setupItem(QTreeWidgetItem *item, ConnectionData *c)
+void MainWindow::on_actionDelete_triggered()
 {
-    item->setFlags(item->flags() | Qt::ItemIsEditable);
-    item->setData(0, Qt::UserRole, c->Uuid);
-    item->setIcon(0, QIcon(":/Icons/computer.png"));
+    QModelIndex index = selectedIndex();
 
-    ui->connList->clearSelection();
-    item->setSelected(true);
-}
+    if (!index.isValid() || model->TypeOf(index) != ConnectionItem)
+        return;
 
-QTreeWidgetItem *MainWindow::addItem(QTreeWidget *v, ConnectionData *c)
-{
-    QTreeWidgetItem *item = new QTreeWidgetItem(v, QStringList(QString(c->Name)), ConnectionItem);
-    ui->connList->sortItems(0, Qt::AscendingOrder);
+    QUuid id = model->UuidOf(index);
+    if (QMessageBox::question(0, QString("Delete connection"),
+            QString("Really delete this connection?"),
+            QMessageBox::Yes | QMessageBox::No,
+            QMessageBox::Yes) != QMessageBox::Yes)
+        return;
 
-    setupItem(item, c);
+    ConnectionData *c = model->Connection(id);
+    if (c && c->Dynamic)
+        return;
+
+    store->Removed(id);
+    model->Remove(id);
+}
 
-    return item;
+void MainWindow::itemRenamed(QUuid uuid)
+{
+    if (model->Group(uuid))
+        store->Changed(model->Group(uuid));
+    else if (model->Connection(uuid))
+        store->Changed(model->Connection(uuid));
 }
 
-QTreeWidgetItem *MainWindow::addItem(QTreeWidgetItem *i, ConnectionData *c)
+// Remember which groups are open, for both expanded() and collapsed()
+void MainWindow::groupExpanded(const QModelIndex &index)
 {
-    i->setExpanded(true);
-    QTreeWidgetItem *item = new QTreeWidgetItem(i, QStringList(QString(c->Name)), ConnectionItem);
-    ui->connList->sortItems(0, Qt::AscendingOrder);
+    // Filtering opens groups, that is not the user's doing
+    if (proxy->IsFiltering())
+        return;
 
-    setupItem(item, c);
+    QUuid uuid = model->UuidOf(proxy->mapToSource(index));
 
-    return item;
+    GroupData *grp = model->Group(uuid);
+    if (grp == 0)
+        return;
+
+    grp->Expanded = ui->connList->isExpanded(index);
+    store->Changed(grp);
+
+    // Dynamic groups are fetched the first time they are opened
+    if (grp->Expanded && grp->Dynamic && grp->LastLoaded == 0)
+        loadGroup(uuid);
 }
 
-void MainWindow::on_actionDelete_triggered()
+void MainWindow::filterChanged(const QString &text)
 {
-    QTreeWidgetItem *item = selectedItem();
+    bool wasFiltering = proxy->IsFiltering();
 
-    if (item == 0 || item->type() != ConnectionItem)
+    proxy->SetFilter(text);
+
+    if (proxy->IsFiltering())
+    {
+        ui->connList->expandAll();
         return;
+    }
 
-    QUuid id = item->data(0, Qt::UserRole).toUuid();
-    if (QMessageBox::question(0, QString("Delete connection"),
-            QString("Really delete this connection?"),
-            QMessageBox::Yes | QMessageBox::No,
-            QMessageBox::Yes) != QMessageBox::Yes)
+    if (!wasFiltering)
         return;
 
-    if (connections.contains(id))
+    // Back to the groups the user had open
+    foreach (GroupData *grp, model->Groups())
+        ui->connList->setExpanded(proxy->mapFromSource(model->IndexOf(grp->Uuid)), grp->Expanded);
+}
+
+// Connect to the selected match, or to the first one
+void MainWindow::filterReturnPressed()
+{
+    if (!selectedIndex().isValid())
     {
-        ConnectionData *c = connections[id];
-        if (c->Dynamic)
+        QModelIndex first;
+
+        for (int i = 0 ; i < proxy->rowCount() && !first.isValid() ; i++)
+        {
+            QModelIndex row = proxy->index(i, 0);
+            if (model->TypeOf(proxy->mapToSource(row)) == ConnectionItem)
+            {
+                first = row;
+                break;
+            }
+
+            if (proxy->rowCount(row) > 0)
+                first = proxy->index(0, 0, row);
+        }
+
+        if (!first.isValid())
             return;
-        connections.remove(c->Uuid);
-        delete c;
+
+        ui->connList->setCurrentIndex(first);
     }
-    delete item;
 
-    WriteSettings();
+    ui->action_Connect->trigger();
+}
+
+void MainWindow::startSweep()
+{
+    prober->Sweep(model->Connections());
 }
 
-void MainWindow::treeWidgetItemChanged(QTreeWidgetItem *item, int)
+void MainWindow::sweepDone(int up, int total, qint64 elapsed)
 {
-    QUuid uuid = item->data(0, Qt::UserRole).toUuid();
+    statusBar()->showMessage(QString("%1 of %2 simulators up, checked in %3 s").arg(up).arg(total).arg(elapsed / 1000.0, 0, 'f', 1), 5000);
+}
 
-    if (groups.contains(uuid))
-        groups[uuid]->Name = item->text(0);
-    if (connections.contains(uuid))
-        connections[uuid]->Name = item->text(0);
+void MainWindow::healthToggled(bool on)
+{
+    prober->SetEnabled(on);
+
+    // Stale colors are worse than none
+    if (!on)
+    {
+        foreach (ConnectionData *c, model->Connections())
+            model->SetStatus(c->Uuid, StatusUnknown);
+    }
 
     WriteSettings();
 }
@@ -868,21 +914,54 @@ void MainWindow::on_action_Preferences_triggered()
 
     dlg.ui->blackOnWhite->setChecked(blackOnWhite);
     dlg.ui->useSystemFonts->setChecked(systemFont);
+    dlg.ui->idleTimeout->setValue(idleTimeout);
+    dlg.ui->memoryBudget->setValue(memoryBudget);
+    dlg.ui->alertRules->setPlainText(alertRules.join("\n"));
+    dlg.ui->alertTray->setChecked(alertTray);
+    dlg.ui->alertTab->setChecked(alertTab);
+    dlg.ui->alertSound->setChecked(alertSound);
+    dlg.ui->metricRules->setPlainText(metricRules.join("\n"));
 
     if (dlg.exec() < 0)
         return;
 
     blackOnWhite = dlg.ui->blackOnWhite->isChecked();
     systemFont = dlg.ui->useSystemFonts->isChecked();
+    idleTimeout = dlg.ui->idleTimeout->value();
+    memoryBudget = dlg.ui->memoryBudget->value();
+    alertRules = dlg.ui->alertRules->toPlainText().split('\n', QString::SkipEmptyParts);
+    alertTray = dlg.ui->alertTray->isChecked();
+    alertTab = dlg.ui->alertTab->isChecked();
+    alertSound = dlg.ui->alertSound->isChecked();
+
+    applyAlertRules();
+
+    metricRules = dlg.ui->metricRules->toPlainText().split('\n', QString::SkipEmptyParts);
+    MetricExtractor::SetRules(metricRules);
+
+    SessionManager::Instance()->SetIdleTimeout(idleTimeout);
+    MemoryBudget::Instance()->SetBudget(memoryBudget);
 
     WriteSettings();
+
+    // Open panes take on the new look right away
+    PaneTheme::Invalidate();
+    PanePool::Instance()->ApplyTheme();
+    foreach (ConnectionPane *pane, ui->consolePane->findChildren<ConnectionPane *>())
+        pane->ApplyTheme();
 }
 
-void MainWindow::loadGroup(QTreeWidgetItem *item)
+// Fetch the member list of a dynamic group. Unless the group was
+// cleared, the server is asked to only send it if it changed.
+void MainWindow::loadGroup(QUuid grpUuid)
 {
-    QUuid grpUuid = item->data(0, Qt::UserRole).toUuid();
+    GroupData *grp = model->Group(grpUuid);
+    if (!grp)
+        return;
 
-    GroupData *grp = groups[grpUuid];
+    // One request per group at a time
+    if (groupLoaders.contains(grpUuid))
+        return;
 
     QUrl url(grp->Source);
     if (!url.isValid())
@@ -890,83 +969,412 @@ void MainWindow::loadGroup(QTreeWidgetItem *item)
 
     QNetworkRequest req(url);
     req.setAttribute(QNetworkRequest::FollowRedirectsAttribute, true);
-    QNetworkReply *reply = manager->get(req);
-    reply->setProperty("Group", grpUuid);
-    connect(reply, SIGNAL(finished()), this, SLOT(groupLoaded()));
+    if (!grp->ETag.isEmpty())
+        req.setRawHeader("If-None-Match", grp->ETag);
+    if (!grp->LastModified.isEmpty())
+        req.setRawHeader("If-Modified-Since", grp->LastModified);
+
+    grp->LastLoaded = QDateTime::currentMSecsSinceEpoch();
+
+    MemberListLoader *loader = new MemberListLoader(manager->get(req), grpUuid, this);
+
+    // Members are matched to the list by host and port, so the ones that
+    // stay keep their UUID and their open tabs.
+    foreach (ConnectionData *c, model->Members(grpUuid))
+        loader->Remaining.insert(MemberListLoader::Key(c->Host, c->Port), c->Uuid);
+
+    groupLoaders[grpUuid] = loader;
+    connect(loader, SIGNAL(Entries(QList<MemberEntry>)), this, SLOT(groupEntries(QList<MemberEntry>)));
+    connect(loader, SIGNAL(Done(bool)), this, SLOT(groupLoaded(bool)));
 }
 
-void MainWindow::groupLoaded()
+// A batch of the member list has been parsed
+void MainWindow::groupEntries(QList<MemberEntry> entries)
 {
-    QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+    MemberListLoader *loader = qobject_cast<MemberListLoader *>(sender());
+
+    QUuid grpUuid = loader->Group();
+    if (groupLoaders.value(grpUuid) != loader)
+        return;
 
-    if (reply->error() != QNetworkReply::NoError)
+    GroupData *grp = model->Group(grpUuid);
+    if (!grp)
         return;
 
-    QUuid grpUuid = reply->property("Group").toUuid();
-    if (grpUuid.isNull())
+    QList<ConnectionData *> added;
+
+    foreach (MemberEntry entry, entries)
+    {
+        QString key = MemberListLoader::Key(entry.Host, entry.Port);
+
+        // A host and port the list already had is one member, not two.
+        // Members left over from an earlier repeat go in groupLoaded().
+        if (loader->Matched.contains(key))
+            continue;
+        loader->Matched.insert(key);
+
+        QUuid uuid;
+        QMultiHash<QString, QUuid>::iterator it = loader->Remaining.find(key);
+        if (it != loader->Remaining.end())
+        {
+            uuid = it.value();
+            loader->Remaining.erase(it);
+        }
+
+        ConnectionData *c = model->Connection(uuid);
+        if (c)
+        {
+            if (c->Name != entry.Name || c->User != grp->User || c->Pass != grp->Pass)
+            {
+                c->Name = entry.Name;
+                c->User = grp->User;
+                c->Pass = grp->Pass;
+                model->Changed(c->Uuid);
+            }
+            continue;
+        }
+
+        c = new ConnectionData();
+        c->Name = entry.Name;
+        c->Uuid = QUuid::createUuid();
+        c->Group = grp->Uuid;
+        c->Host = entry.Host;
+        c->Port = entry.Port;
+        c->User = grp->User;
+        c->Pass = grp->Pass;
+        c->Dynamic = true;
+
+        added.append(c);
+    }
+
+    // One insert per batch
+    model->AddConnections(grpUuid, added);
+}
+
+void MainWindow::groupLoaded(bool ok)
+{
+    MemberListLoader *loader = qobject_cast<MemberListLoader *>(sender());
+
+    QUuid grpUuid = loader->Group();
+    if (groupLoaders.value(grpUuid) != loader)
         return;
 
-    QTreeWidgetItem *grpItem = findItem(grpUuid);
-    if (!grpItem)
+    groupLoaders.remove(grpUuid);
+
+    GroupData *grp = model->Group(grpUuid);
+    if (!grp || !ok)
         return;
 
-    if (!groups.contains(grpUuid))
+    // Not modified since the last time
+    if (loader->NotModified())
         return;
 
-    GroupData *grp = groups[grpUuid];
+    grp->ETag = loader->Reply()->rawHeader("ETag");
+    grp->LastModified = loader->Reply()->rawHeader("Last-Modified");
 
-    QString members = QString(reply->readAll());
+    // Whatever is left has gone from the list
+    model->RemoveConnections(loader->Remaining.values());
 
-    QList<QString> lines = members.split("\n");
+    MemberCache::Instance()->Update(grp, model->Members(grpUuid));
+}
 
-    ui->connList->blockSignals(true);
+// Refresh the dynamic groups that asked for it
+void MainWindow::refreshGroups()
+{
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
 
-    QString line;
-    foreach (line, lines)
+    foreach (GroupData *grp, model->Groups())
     {
-        QList<QString> pieces = line.split(" ");
-        if (pieces.count() < 2)
+        // Groups that were never opened wait until they are
+        if (!grp->Dynamic || grp->RefreshInterval <= 0 || grp->LastLoaded == 0)
             continue;
-        QString host = pieces[0];
 
-        int port = 9000;
-        QList<QString> addrparts = host.split(":");
-        if (addrparts.count() > 1)
+        if (now - grp->LastLoaded >= qint64(grp->RefreshInterval) * 60000)
+            loadGroup(grp->Uuid);
+    }
+}
+
+void MainWindow::on_action_Export_triggered()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, QString("Export connections"), QString(), QString("JSON Lines (*.jsonl)"));
+    if (fileName.isEmpty())
+        return;
+
+    if (!ConnectionStore::Export(fileName, model->Groups(), model->Connections()))
+        QMessageBox::warning(this, QString("Export connections"), QString("Could not write %1").arg(fileName));
+}
+
+// Records already in the list are left alone. Connections whose group
+// is not known end up at the top.
+void MainWindow::on_action_Import_triggered()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, QString("Import connections"), QString(), QString("JSON Lines (*.jsonl);;All files (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    QList<GroupData *> importedGroups;
+    QList<ConnectionData *> importedConnections;
+
+    if (!ConnectionStore::Import(fileName, &importedGroups, &importedConnections))
+    {
+        QMessageBox::warning(this, QString("Import connections"), QString("Could not read %1").arg(fileName));
+        return;
+    }
+
+    int added = 0;
+
+    foreach (GroupData *grp, importedGroups)
+    {
+        if (model->Group(grp->Uuid) || model->Connection(grp->Uuid))
         {
-            host = addrparts[0];
-            port = addrparts[1].toInt();
+            delete grp;
+            continue;
         }
 
-        pieces.removeFirst();
-        QString name = pieces.join(" ");
-        if (name.trimmed() == "")
+        model->AddGroup(grp);
+        store->Changed(grp);
+        added++;
+    }
+
+    QHash<QUuid, QList<ConnectionData *> > byGroup;
+
+    foreach (ConnectionData *c, importedConnections)
+    {
+        if (model->Group(c->Uuid) || model->Connection(c->Uuid))
+        {
+            delete c;
             continue;
+        }
 
-        name[0] = name[0].toUpper();
+        GroupData *grp = model->Group(c->Group);
+        if (grp == 0 || grp->Dynamic)
+            c->Group = QUuid();
 
-        ConnectionData *c = new ConnectionData();
-        c->Name = name;
-        c->Uuid = QUuid::createUuid();
-        c->Group = grp->Uuid;
-        c->Host = host;
-        c->Port = port;
-        c->User = grp->User;
-        c->Pass = grp->Pass;
-        c->Dynamic = true;
+        byGroup[c->Group].append(c);
+    }
+
+    for (QHash<QUuid, QList<ConnectionData *> >::const_iterator it = byGroup.constBegin() ; it != byGroup.constEnd() ; ++it)
+    {
+        model->AddConnections(it.key(), it.value());
+
+        foreach (ConnectionData *c, it.value())
+            store->Changed(c);
+        added += it.value().size();
+    }
+
+    statusBar()->showMessage(QString("Imported %1 entries").arg(added), 10000);
+}
+
+void MainWindow::on_action_Timeline_triggered()
+{
+    QMessageBox box(QMessageBox::Information, QString("Startup timeline"), StartupTimeline::Report(), QMessageBox::Ok, this);
+
+    QFont font("Courier");
+    font.setStyleHint(QFont::Monospace);
+    box.setFont(font);
+
+    box.exec();
+}
+
+// The dashboard is a tab of its own. There is only ever one.
+void MainWindow::on_action_Dashboard_triggered()
+{
+    if (!dashboard)
+    {
+        dashboard = new DashboardView(ui->consolePane);
+        connect(dashboard, SIGNAL(Activated(ConnectionPane *)), this, SLOT(showPane(ConnectionPane *)));
+        ui->consolePane->addTab(dashboard, QString("Overview"));
+    }
+
+    ui->consolePane->setCurrentWidget(dashboard);
+
+    updateSessionViews();
+}
+
+void MainWindow::on_action_MergedLog_triggered()
+{
+    if (!mergedLog)
+    {
+        mergedLog = new MergedLogView(ui->consolePane);
+        ui->consolePane->addTab(mergedLog, QString("Merged log"));
+    }
+
+    ui->consolePane->setCurrentWidget(mergedLog);
+
+    updateSessionViews();
+}
+
+void MainWindow::on_action_Memory_triggered()
+{
+    if (!memoryView)
+    {
+        memoryView = new MemoryView(ui->consolePane);
+        connect(memoryView, SIGNAL(Activated(ConnectionPane *)), this, SLOT(showPane(ConnectionPane *)));
+        ui->consolePane->addTab(memoryView, QString("Memory"));
+    }
+
+    ui->consolePane->setCurrentWidget(memoryView);
+}
+
+// The dialog works on copies, only what it changed goes to the
+// scheduler and the store
+void MainWindow::on_action_Jobs_triggered()
+{
+    JobsDialog dlg(scheduler, model, this);
+
+    if (dlg.exec() != 0)
+        return;
+
+    QList<JobData> edited = dlg.Jobs();
+    QSet<QUuid> kept;
+
+    foreach (const JobData &e, edited)
+    {
+        kept.insert(e.Uuid);
+
+        JobData *job = scheduler->Job(e.Uuid);
+        if (job == 0)
+        {
+            job = new JobData(e);
+            scheduler->AddJob(job);
+            store->Changed(job);
+            continue;
+        }
+
+        if (job->Name == e.Name && job->Command == e.Command && job->Interval == e.Interval &&
+                job->Target == e.Target && job->Enabled == e.Enabled)
+            continue;
 
-        connections[c->Uuid] = c;
+        *job = e;
+        scheduler->Changed(job->Uuid);
+        store->Changed(job);
+    }
 
-        // Dynamic items are not editable
-        QTreeWidgetItem *item = new QTreeWidgetItem(grpItem, QStringList(name), ConnectionItem);
-        item->setData(0, Qt::UserRole, c->Uuid);
-        item->setIcon(0, QIcon(":/Icons/computer.png"));
+    foreach (JobData *job, scheduler->Jobs())
+    {
+        if (kept.contains(job->Uuid))
+            continue;
 
+        QUuid uuid = job->Uuid;
+        store->Removed(uuid);
+        scheduler->RemoveJob(uuid);
     }
+}
+
+// Every console in a tab, in the order of the tabs
+QList<ConnectionPane *> MainWindow::openPanes()
+{
+    QList<ConnectionPane *> panes;
 
-    ui->connList->blockSignals(false);
-    ui->connList->sortByColumn(0, Qt::AscendingOrder);
+    for (int i = 0 ; i < ui->consolePane->count() ; i++)
+    {
+        QWidget *w = ui->consolePane->widget(i);
 
-    reply->deleteLater();
+        if (w->inherits("ConnectionPane"))
+        {
+            panes.append((ConnectionPane *)w);
+        }
+        else if (w->inherits("QTabWidget"))
+        {
+            QTabWidget *tabs = (QTabWidget *)w;
+
+            for (int j = 0 ; j < tabs->count() ; j++)
+            {
+                if (tabs->widget(j)->inherits("ConnectionPane"))
+                    panes.append((ConnectionPane *)tabs->widget(j));
+            }
+        }
+    }
+
+    return panes;
+}
+
+// The views that show several consoles follow the tabs
+void MainWindow::updateSessionViews()
+{
+    if (!dashboard && !mergedLog)
+        return;
+
+    QList<ConnectionPane *> panes = openPanes();
+
+    if (dashboard)
+        dashboard->SetPanes(panes);
+    if (mergedLog)
+        mergedLog->SetPanes(panes);
+}
+
+// Bring up the tab of a console, and the group tab it is in
+void MainWindow::showPane(ConnectionPane *pane)
+{
+    QTabWidget *tabs = qobject_cast<QTabWidget *>(pane->parentWidget()->parentWidget());
+    if (!tabs)
+        return;
+
+    tabs->setCurrentWidget(pane);
+
+    if (tabs != ui->consolePane)
+        ui->consolePane->setCurrentWidget(tabs);
+}
+
+void MainWindow::applyAlertRules()
+{
+    QList<AlertRule> rules;
+
+    foreach (QString text, alertRules)
+    {
+        AlertRule rule = AlertRule::Parse(text);
+        if (!rule.Pattern.isEmpty())
+            rules.append(rule);
+    }
+
+    AlertEngine::Instance()->SetRules(rules);
+}
+
+// The tab of the console turns red until it is looked at. Notices and
+// sounds come at most every few seconds, however many lines match.
+void MainWindow::alertRaised(ConnectionPane *pane, QString rule, QString line)
+{
+    QString message = pane->GetName() + QString(": ") + line.trimmed();
+
+    statusBar()->showMessage(message, 10000);
+
+    if (alertTab)
+    {
+        QTabWidget *tabs = qobject_cast<QTabWidget *>(pane->parentWidget() ? pane->parentWidget()->parentWidget() : 0);
+        if (tabs)
+        {
+            if (tabs->currentWidget() != pane)
+                tabs->tabBar()->setTabTextColor(tabs->indexOf(pane), Qt::red);
+
+            if (tabs != ui->consolePane && ui->consolePane->currentWidget() != tabs)
+                ui->consolePane->tabBar()->setTabTextColor(ui->consolePane->indexOf(tabs), Qt::red);
+        }
+    }
+
+    if (lastAlert.isValid() && lastAlert.elapsed() < 5000)
+        return;
+    lastAlert.start();
+
+    if (alertTray && QSystemTrayIcon::isSystemTrayAvailable())
+    {
+        if (!tray)
+        {
+            tray = new QSystemTrayIcon(windowIcon(), this);
+            tray->show();
+        }
+
+        tray->showMessage(rule, message, QSystemTrayIcon::Warning);
+    }
+
+    if (alertSound)
+        QApplication::beep();
+}
+
+void MainWindow::tabChanged(int index)
+{
+    QTabWidget *tabs = qobject_cast<QTabWidget *>(sender());
+    if (tabs && index >= 0)
+        tabs->tabBar()->setTabTextColor(index, QColor());
 }
 
 void MainWindow::on_action_About_triggered()
@@ -978,30 +1386,40 @@ void MainWindow::on_action_About_triggered()
 
 void MainWindow::onRefreshDynamicItem()
 {
-    QTreeWidgetItem *item = selectedItem();
+    QModelIndex index = selectedIndex();
 
-    if (item == 0 || item->type() != GroupItem)
+    if (!index.isValid() || model->TypeOf(index) != GroupItem)
         return;
 
-    reloadGroup(item);
+    loadGroup(model->UuidOf(index));
 }
 
-void MainWindow::clearGroup(QTreeWidgetItem *item)
+void MainWindow::clearGroup(QUuid uuid)
 {
-    while (item->childCount())
-        delete item->child(0);
-
-    QUuid id = item->data(0, Qt::UserRole).toUuid();
-
-    for (QMap<QUuid, ConnectionData *>::Iterator it = connections.begin() ; it != connections.end() ; ++it)
+    foreach (ConnectionData *c, model->Members(uuid))
     {
-        if ((*it)->Group == id)
-            connections.remove(it.key());
+        if (!c->Dynamic)
+            store->Removed(c->Uuid);
     }
+
+    model->ClearGroup(uuid);
 }
 
-void MainWindow::reloadGroup(QTreeWidgetItem *item)
+// Start over, for when the source of the list changed
+void MainWindow::reloadGroup(QUuid uuid)
 {
-    clearGroup(item);
-    loadGroup(item);
+    clearGroup(uuid);
+    MemberCache::Instance()->Remove(uuid);
+
+    if (groupLoaders.contains(uuid))
+        groupLoaders.take(uuid)->Abort();
+
+    GroupData *grp = model->Group(uuid);
+    if (grp)
+    {
+        grp->ETag.clear();
+        grp->LastModified.clear();
+    }
+
+    loadGroup(uuid);
 }
@@ -6,15 +6,29 @@
 #include <QMap>
 #include <QUuid>
 #include <QHostAddress>
+#include <QModelIndex>
+#include <QPointer>
+#include <QStringList>
+#include <QElapsedTimer>
+
+#include "memberlistloader.h"
 
 class ConnectionPane;
-class QTreeWidget;
-class QTreeWidgetItem;
+class ConnectionModel;
+class ConnectionStore;
+class ConnectionFilterModel;
+class HealthProber;
+class JobScheduler;
+class DashboardView;
+class MergedLogView;
+class MemoryView;
 class ConnectionData;
 class GroupData;
 class QSettings;
 class QNetworkAccessManager;
 class QNetworkReply;
+class QTimer;
+class QSystemTrayIcon;
 
 namespace Ui {
 class MainWindow;
@@ -52,7 +66,7 @@ private slots:
 
     void CloseTab(int index);
     void ConnContext(const QPoint &);
-    void ConnectionDoubleClicked(QTreeWidgetItem * item, int column = 0);
+    void ConnectionDoubleClicked(const QModelIndex &index);
     void on_actionCopy_triggered();
 
     void on_actionNew_group_triggered();
@@ -61,36 +75,80 @@ private slots:
 
     void on_action_About_triggered();
 
+    void on_action_Timeline_triggered();
+
+    void on_action_Import_triggered();
+
+    void on_action_Export_triggered();
+
+    void on_action_Dashboard_triggered();
+
+    void on_action_MergedLog_triggered();
+
+    void on_action_Jobs_triggered();
+
+    void on_action_Memory_triggered();
+
 public:
 protected:
-    QMap<QUuid, ConnectionData *> connections;
-    QMap<QUuid, GroupData *> groups;
+    ConnectionModel *model;
+    ConnectionFilterModel *proxy;
+    ConnectionStore *store;
     ConnectionData *createConnection();
-    QTreeWidgetItem *addItem(QTreeWidget *v, ConnectionData *c);
-    QTreeWidgetItem *addItem(QTreeWidgetItem *i, ConnectionData *c);
-    void setupItem(QTreeWidgetItem *item, ConnectionData *c);
     GroupData *createGroup();
-    QTreeWidgetItem *insertGroup(GroupData *grp);
-    QTreeWidgetItem *findItem(QUuid uuid);
-    QTreeWidgetItem *selectedItem();
+    QModelIndex selectedIndex();
+    void selectUuid(QUuid uuid);
     QWidget *findTab(QTabWidget *parent, QUuid uuid);
     void AddNewTab(GroupData *grp, ConnectionData *conn, QHostAddress addr);
     bool blackOnWhite;
     bool systemFont;
+    int idleTimeout;
+    int memoryBudget;
+    QStringList alertRules;
+    QStringList metricRules;
+    bool alertTray;
+    bool alertTab;
+    bool alertSound;
+    QSystemTrayIcon *tray;
+    QElapsedTimer lastAlert;
     QNetworkAccessManager *manager;
-
-    void loadGroup(QTreeWidgetItem *item);
+    QMap<QUuid, MemberListLoader *> groupLoaders;
+    QTimer *refreshTimer;
+    HealthProber *prober;
+    JobScheduler *scheduler;
+    QPointer<DashboardView> dashboard;
+    QPointer<MergedLogView> mergedLog;
+    QPointer<MemoryView> memoryView;
+    bool started;
+
+    void loadGroup(QUuid grpUuid);
     void showEvent(QShowEvent *event);
-    void reloadGroup(QTreeWidgetItem *item);
-    void clearGroup(QTreeWidgetItem *item);
+    void closeEvent(QCloseEvent *event);
+    void reloadGroup(QUuid uuid);
+    void clearGroup(QUuid uuid);
+    QList<ConnectionPane *> openPanes();
+    void updateSessionViews();
+    void applyAlertRules();
 protected slots:
     void addRootConnection();
     void addChildConnection();
-    void treeWidgetItemChanged(QTreeWidgetItem *item, int column);
-    void groupLoaded();
+    void itemRenamed(QUuid uuid);
+    void groupExpanded(const QModelIndex &index);
+    void filterChanged(const QString &text);
+    void filterReturnPressed();
+    void groupEntries(QList<MemberEntry> entries);
+    void groupLoaded(bool ok);
+    void refreshGroups();
+    void loadConnections();
+    void startSweep();
+    void sweepDone(int up, int total, qint64 elapsed);
+    void healthToggled(bool on);
     void onRefreshDynamicItem();
+    void sessionReport(QString message);
+    void showPane(ConnectionPane *pane);
+    void alertRaised(ConnectionPane *pane, QString rule, QString line);
+    void tabChanged(int index);
 private:
-    QTreeWidgetItem *findOrAddGroup(QString groupName);
     Ui::MainWindow *ui;
 };
 
@@ -0,0 +1,188 @@
+#include "membercache.h"
+#include "groupdata.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+#include <QTimer>
+#include <QDebug>
+
+static const quint32 CacheMagic = 0x4d4c4331;
+static const quint32 CacheVersion = 1;
+
+// The least a member takes up as written by Save()
+static const int MemberBytes = 16 + 4 + 4 + 4;
+
+MemberCache *MemberCache::Instance()
+{
+    static MemberCache *instance = 0;
+
+    if (instance == 0)
+        instance = new MemberCache(QCoreApplication::instance());
+
+    return instance;
+}
+
+MemberCache::MemberCache(QObject *parent) :
+    QObject(parent),
+    dirty(false)
+{
+    saveTimer = new QTimer(this);
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(2000);
+    connect(saveTimer, SIGNAL(timeout()), this, SLOT(Save()));
+
+    Load();
+}
+
+MemberCache::~MemberCache()
+{
+    if (dirty)
+        Save();
+}
+
+// Hand out copies of the cached members, and the validators that go
+// with them
+void MemberCache::Restore(GroupData *grp, QList<ConnectionData *> *members)
+{
+    if (!groups.contains(grp->Uuid))
+        return;
+
+    const Entry &entry = groups[grp->Uuid];
+
+    grp->ETag = entry.ETag;
+    grp->LastModified = entry.LastModified;
+
+    foreach (const ConnectionData &c, entry.Members)
+    {
+        ConnectionData *copy = new ConnectionData(c);
+        copy->Group = grp->Uuid;
+        copy->User = grp->User;
+        copy->Pass = grp->Pass;
+        copy->Dynamic = true;
+        members->append(copy);
+    }
+}
+
+void MemberCache::Update(GroupData *grp, QList<ConnectionData *> members)
+{
+    Entry &entry = groups[grp->Uuid];
+
+    entry.ETag = grp->ETag;
+    entry.LastModified = grp->LastModified;
+    entry.Members.clear();
+    entry.Members.reserve(members.size());
+
+    foreach (ConnectionData *c, members)
+        entry.Members.append(*c);
+
+    dirty = true;
+    saveTimer->start();
+}
+
+void MemberCache::Remove(QUuid group)
+{
+    if (groups.remove(group) == 0)
+        return;
+
+    dirty = true;
+    saveTimer->start();
+}
+
+QString MemberCache::FileName()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + QString("/members.cache");
+}
+
+void MemberCache::Load()
+{
+    QFile f(FileName());
+    if (!f.open(QIODevice::ReadOnly))
+        return;
+
+    QByteArray data = f.readAll();
+    f.close();
+
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic;
+    quint32 version;
+    quint32 count;
+
+    in >> magic >> version >> count;
+    if (magic != CacheMagic || version != CacheVersion)
+        return;
+
+    for (quint32 i = 0 ; i < count && in.status() == QDataStream::Ok ; i++)
+    {
+        QUuid group;
+        Entry entry;
+        quint32 members;
+
+        in >> group >> entry.ETag >> entry.LastModified >> members;
+
+        // The count comes from the file, don't let it ask for more than
+        // the rest of it could hold
+        if (in.status() != QDataStream::Ok || qint64(members) * MemberBytes > in.device()->bytesAvailable())
+        {
+            qWarning() << "Member cache" << FileName() << "is damaged, ignoring the rest of it";
+            break;
+        }
+
+        entry.Members.reserve(members);
+        for (quint32 j = 0 ; j < members && in.status() == QDataStream::Ok ; j++)
+        {
+            ConnectionData c;
+            qint32 port;
+
+            in >> c.Uuid >> c.Name >> c.Host >> port;
+            c.Port = port;
+            c.Group = group;
+            c.Dynamic = true;
+
+            entry.Members.append(c);
+        }
+
+        if (in.status() != QDataStream::Ok)
+        {
+            qWarning() << "Member cache" << FileName() << "is damaged, ignoring the rest of it";
+            break;
+        }
+
+        groups[group] = entry;
+    }
+}
+
+// Credentials are not cached, they come from the group
+void MemberCache::Save()
+{
+    dirty = false;
+
+    QDir().mkpath(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+
+    QSaveFile f(FileName());
+    if (!f.open(QIODevice::WriteOnly))
+        return;
+
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_6);
+
+    out << CacheMagic << CacheVersion << quint32(groups.size());
+
+    for (QHash<QUuid, Entry>::const_iterator it = groups.constBegin() ; it != groups.constEnd() ; ++it)
+    {
+        const Entry &entry = it.value();
+
+        out << it.key() << entry.ETag << entry.LastModified << quint32(entry.Members.size());
+
+        foreach (const ConnectionData &c, entry.Members)
+            out << c.Uuid << c.Name << c.Host << qint32(c.Port);
+    }
+
+    if (!f.commit())
+        qWarning() << "Could not write member cache" << FileName();
+}
@@ -0,0 +1,53 @@
+#ifndef MEMBERCACHE_H
+#define MEMBERCACHE_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QUuid>
+
+#include "connectiondata.h"
+
+class GroupData;
+class QTimer;
+
+// The last member list of each dynamic group, kept on disk so the tree
+// can show it right away at startup. The list is refreshed when the
+// group is opened, and the validators kept with it let the server
+// answer "not modified" if nothing changed.
+class MemberCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    static MemberCache *Instance();
+
+    ~MemberCache();
+
+    void Restore(GroupData *grp, QList<ConnectionData *> *members);
+    void Update(GroupData *grp, QList<ConnectionData *> members);
+    void Remove(QUuid group);
+
+protected slots:
+    void Save();
+
+protected:
+    struct Entry
+    {
+        QByteArray ETag;
+        QByteArray LastModified;
+        QList<ConnectionData> Members;
+    };
+
+    explicit MemberCache(QObject *parent = 0);
+
+    void Load();
+    QString FileName();
+
+    QHash<QUuid, Entry> groups;
+    QTimer *saveTimer;
+    bool dirty;
+};
+
+#endif // MEMBERCACHE_H
@@ -0,0 +1,416 @@
+#include "memberlistloader.h"
+
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+
+// Parse for at most this long before giving the event loop a turn
+static const int SliceMs = 8;
+
+MemberListLoader::MemberListLoader(QNetworkReply *reply, QUuid group, QObject *parent) :
+    QObject(parent),
+    reply(reply),
+    group(group),
+    format(UnknownFormat),
+    pos(0),
+    depth(0),
+    objectStart(-1),
+    inString(false),
+    escape(false),
+    finished(false),
+    scheduled(false),
+    done(false),
+    headerChecked(false),
+    hostColumn(0),
+    portColumn(1),
+    nameColumn(2)
+{
+    reply->setParent(this);
+
+    connect(reply, SIGNAL(readyRead()), this, SLOT(DataReady()));
+    connect(reply, SIGNAL(finished()), this, SLOT(ReplyFinished()));
+}
+
+QUuid MemberListLoader::Group()
+{
+    return group;
+}
+
+QNetworkReply *MemberListLoader::Reply()
+{
+    return reply;
+}
+
+bool MemberListLoader::NotModified()
+{
+    return reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() == 304;
+}
+
+void MemberListLoader::Abort()
+{
+    reply->abort();
+}
+
+QString MemberListLoader::Key(QString host, int port)
+{
+    return host.toLower() + QString(":") + QString::number(port);
+}
+
+void MemberListLoader::DataReady()
+{
+    buffer.append(reply->readAll());
+
+    Schedule();
+}
+
+void MemberListLoader::ReplyFinished()
+{
+    finished = true;
+
+    if (reply->error() == QNetworkReply::NoError)
+        buffer.append(reply->readAll());
+    else
+        buffer.clear();
+
+    Schedule();
+}
+
+void MemberListLoader::Schedule()
+{
+    if (scheduled || done)
+        return;
+
+    scheduled = true;
+    QTimer::singleShot(0, this, SLOT(Process()));
+}
+
+// Go by the content type, then the file name, then the first character
+void MemberListLoader::Detect()
+{
+    QString type = reply->header(QNetworkRequest::ContentTypeHeader).toString().toLower();
+    QString path = reply->url().path().toLower();
+
+    if (type.contains("json") || path.endsWith(".json") || path.endsWith(".jsonl"))
+        format = JsonFormat;
+    else if (type.contains("csv") || path.endsWith(".csv"))
+        format = CsvFormat;
+
+    if (format != UnknownFormat)
+        return;
+
+    for (int i = 0 ; i < buffer.size() ; i++)
+    {
+        char c = buffer.at(i);
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+            continue;
+
+        if (c == '[' || c == '{')
+            format = JsonFormat;
+        else
+            format = TextFormat;
+        return;
+    }
+
+    if (finished)
+        format = TextFormat;
+}
+
+// Lines for text and CSV, top level objects for JSON. The last line
+// may lack its newline.
+bool MemberListLoader::NextRecord(QByteArray *record)
+{
+    if (format == JsonFormat)
+    {
+        for ( ; pos < buffer.size() ; pos++)
+        {
+            char c = buffer.at(pos);
+
+            if (inString)
+            {
+                if (escape)
+                    escape = false;
+                else if (c == '\\')
+                    escape = true;
+                else if (c == '"')
+                    inString = false;
+                continue;
+            }
+
+            if (c == '"' && depth > 0)
+            {
+                inString = true;
+            }
+            else if (c == '{')
+            {
+                if (depth == 0)
+                    objectStart = pos;
+                depth++;
+            }
+            else if (c == '}' && depth > 0)
+            {
+                depth--;
+                if (depth == 0)
+                {
+                    *record = buffer.mid(objectStart, pos - objectStart + 1);
+                    objectStart = -1;
+                    pos++;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    int nl = buffer.indexOf('\n', pos);
+    if (nl < 0)
+    {
+        if (!finished || pos >= buffer.size())
+            return false;
+        nl = buffer.size();
+    }
+
+    *record = buffer.mid(pos, nl - pos);
+    pos = nl + 1;
+
+    if (record->endsWith('\r'))
+        record->chop(1);
+
+    return true;
+}
+
+void MemberListLoader::Process()
+{
+    scheduled = false;
+
+    if (done)
+        return;
+
+    if (format == UnknownFormat)
+    {
+        Detect();
+        if (format == UnknownFormat)
+            return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    QList<MemberEntry> entries;
+    QByteArray record;
+    bool more = false;
+
+    while (NextRecord(&record))
+    {
+        MemberEntry entry;
+        if (ParseRecord(record, &entry))
+            entries.append(entry);
+
+        if (timer.elapsed() >= SliceMs)
+        {
+            more = true;
+            break;
+        }
+    }
+
+    // Drop what has been parsed, keep a partial record
+    int keep = pos;
+    if (objectStart >= 0)
+        keep = objectStart;
+    if (keep > buffer.size())
+        keep = buffer.size();
+
+    buffer.remove(0, keep);
+    pos -= keep;
+    if (objectStart >= 0)
+        objectStart -= keep;
+
+    if (!entries.isEmpty())
+        emit Entries(entries);
+
+    if (more)
+    {
+        Schedule();
+        return;
+    }
+
+    if (finished)
+    {
+        done = true;
+        emit Done(reply->error() == QNetworkReply::NoError);
+        deleteLater();
+    }
+}
+
+bool MemberListLoader::ParseRecord(QByteArray record, MemberEntry *entry)
+{
+    entry->Port = 0;
+
+    bool ok = false;
+    if (format == JsonFormat)
+        ok = ParseJson(record, entry);
+    else if (format == CsvFormat)
+        ok = ParseCsv(QString::fromUtf8(record), entry);
+    else
+        ok = ParseText(QString::fromUtf8(record), entry);
+
+    if (!ok)
+        return false;
+
+    entry->Host = entry->Host.trimmed();
+    entry->Name = entry->Name.trimmed();
+    if (entry->Host.isEmpty() || entry->Name.isEmpty())
+        return false;
+
+    if (entry->Port <= 0)
+        entry->Port = 9000;
+
+    entry->Name[0] = entry->Name[0].toUpper();
+
+    return true;
+}
+
+bool MemberListLoader::ParseText(QString line, MemberEntry *entry)
+{
+    QList<QString> pieces = line.split(" ");
+    if (pieces.count() < 2)
+        return false;
+
+    entry->Host = pieces[0];
+
+    QList<QString> addrparts = entry->Host.split(":");
+    if (addrparts.count() > 1)
+    {
+        entry->Host = addrparts[0];
+        entry->Port = addrparts[1].toInt();
+    }
+
+    pieces.removeFirst();
+    entry->Name = pieces.join(" ");
+
+    return true;
+}
+
+// A first line naming a "host" column is taken as the header. Without
+// one, the columns are host, port and name, or host[:port] and name.
+bool MemberListLoader::ParseCsv(QString line, MemberEntry *entry)
+{
+    QStringList fields = SplitCsv(line);
+
+    if (!headerChecked)
+    {
+        headerChecked = true;
+
+        QStringList names;
+        foreach (QString f, fields)
+            names.append(f.trimmed().toLower());
+
+        if (names.contains("host"))
+        {
+            hostColumn = names.indexOf("host");
+            portColumn = names.indexOf("port");
+            nameColumn = names.indexOf("name");
+            return false;
+        }
+    }
+
+    if (fields.count() == 2 && portColumn == 1 && nameColumn == 2)
+    {
+        fields.insert(1, QString());
+
+        QStringList addrparts = fields[0].split(":");
+        if (addrparts.count() > 1)
+        {
+            fields[0] = addrparts[0];
+            fields[1] = addrparts[1];
+        }
+    }
+
+    if (hostColumn < 0 || nameColumn < 0 || hostColumn >= fields.count() || nameColumn >= fields.count())
+        return false;
+
+    entry->Host = fields[hostColumn];
+    entry->Name = fields[nameColumn];
+    if (portColumn >= 0 && portColumn < fields.count())
+        entry->Port = fields[portColumn].trimmed().toInt();
+
+    return true;
+}
+
+bool MemberListLoader::ParseJson(QByteArray object, MemberEntry *entry)
+{
+    QJsonObject o = QJsonDocument::fromJson(object).object();
+    if (o.isEmpty())
+        return false;
+
+    entry->Host = o["host"].toString();
+    entry->Name = o["name"].toString();
+
+    QJsonValue port = o["port"];
+    if (port.isString())
+        entry->Port = port.toString().toInt();
+    else
+        entry->Port = port.toInt();
+
+    QStringList addrparts = entry->Host.split(":");
+    if (entry->Port == 0 && addrparts.count() > 1)
+    {
+        entry->Host = addrparts[0];
+        entry->Port = addrparts[1].toInt();
+    }
+
+    return true;
+}
+
+// Comma separated, fields may be quoted with "" for a literal quote
+QStringList MemberListLoader::SplitCsv(QString line)
+{
+    QStringList fields;
+    QString field;
+    bool quoted = false;
+
+    for (int i = 0 ; i < line.size() ; i++)
+    {
+        QChar c = line.at(i);
+
+        if (quoted)
+        {
+            if (c == '"')
+            {
+                if (i + 1 < line.size() && line.at(i + 1) == '"')
+                {
+                    field.append(c);
+                    i++;
+                }
+                else
+                {
+                    quoted = false;
+                }
+            }
+            else
+            {
+                field.append(c);
+            }
+        }
+        else if (c == '"')
+        {
+            quoted = true;
+        }
+        else if (c == ',')
+        {
+            fields.append(field);
+            field.clear();
+        }
+        else
+        {
+            field.append(c);
+        }
+    }
+    fields.append(field);
+
+    return fields;
+}
@@ -0,0 +1,97 @@
+#ifndef MEMBERLISTLOADER_H
+#define MEMBERLISTLOADER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QUuid>
+
+class QNetworkReply;
+
+struct MemberEntry
+{
+    QString Name;
+    QString Host;
+    int Port;
+};
+
+// Reads the member list of a dynamic group as it arrives and hands it
+// out in batches, a few milliseconds of parsing at a time, so a large
+// grid doesn't hold up the window. Three formats are understood:
+//
+//   host[:port] Name           one region per line
+//   host,port,name             CSV, optionally with a header line
+//   [{"host": ..., "port": ..., "name": ...}, ...]   or one object per line
+//
+// The loader owns the reply and deletes itself after Done().
+class MemberListLoader : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Format
+    {
+        UnknownFormat,
+        TextFormat,
+        JsonFormat,
+        CsvFormat
+    };
+
+    MemberListLoader(QNetworkReply *reply, QUuid group, QObject *parent = 0);
+
+    QUuid Group();
+    QNetworkReply *Reply();
+    bool NotModified();
+    void Abort();
+
+    static QString Key(QString host, int port);
+
+    // Members of the group not seen in the list so far, by Key(). A
+    // key may have more than one member if the list had it twice.
+    QMultiHash<QString, QUuid> Remaining;
+
+    // Keys the list has had so far
+    QSet<QString> Matched;
+
+signals:
+    void Entries(QList<MemberEntry> entries);
+    void Done(bool ok);
+
+protected slots:
+    void DataReady();
+    void ReplyFinished();
+    void Process();
+
+protected:
+    void Schedule();
+    void Detect();
+    bool NextRecord(QByteArray *record);
+    bool ParseRecord(QByteArray record, MemberEntry *entry);
+    bool ParseText(QString line, MemberEntry *entry);
+    bool ParseCsv(QString line, MemberEntry *entry);
+    bool ParseJson(QByteArray object, MemberEntry *entry);
+    static QStringList SplitCsv(QString line);
+
+    QNetworkReply *reply;
+    QUuid group;
+    Format format;
+    QByteArray buffer;
+    int pos;
+    int depth;
+    int objectStart;
+    bool inString;
+    bool escape;
+    bool finished;
+    bool scheduled;
+    bool done;
+    bool headerChecked;
+    int hostColumn;
+    int portColumn;
+    int nameColumn;
+};
+
+#endif // MEMBERLISTLOADER_H
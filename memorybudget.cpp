@@ -0,0 +1,189 @@
+#include "memorybudget.h"
+#include "connectionpane.h"
+#include "commandtree.h"
+
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QTimer>
+#include <QDebug>
+
+#include <algorithm>
+
+// Once over budget, give back enough to end up this far below it, so
+// the next few polls don't go over again
+static const int TargetPercent = 90;
+
+// Entries kept in the reclaim log
+static const int MaxLog = 500;
+
+MemoryBudget *MemoryBudget::Instance()
+{
+    static MemoryBudget *instance = 0;
+
+    if (instance == 0)
+        instance = new MemoryBudget(QCoreApplication::instance());
+
+    return instance;
+}
+
+MemoryBudget::MemoryBudget(QObject *parent) :
+    QObject(parent),
+    total(0),
+    budget(0)
+{
+    checkTimer = new QTimer(this);
+    checkTimer->setInterval(15000);
+    connect(checkTimer, SIGNAL(timeout()), this, SLOT(Check()));
+    checkTimer->start();
+}
+
+QString MemoryBudget::Size(qint64 bytes)
+{
+    if (bytes >= 1024 * 1024)
+        return QString("%1 MB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+
+    return QString("%1 KB").arg((bytes + 1023) / 1024);
+}
+
+void MemoryBudget::Register(ConnectionPane *pane)
+{
+    if (!panes.contains(pane))
+        panes.append(pane);
+}
+
+void MemoryBudget::Unregister(ConnectionPane *pane)
+{
+    panes.removeAll(pane);
+    usage.remove(pane);
+}
+
+// In MB, 0 for no limit
+void MemoryBudget::SetBudget(int megabytes)
+{
+    budget = megabytes;
+
+    Check();
+}
+
+int MemoryBudget::Budget()
+{
+    return budget;
+}
+
+QList<ConnectionPane *> MemoryBudget::Sessions()
+{
+    return panes;
+}
+
+// As of the last check
+SessionMemory MemoryBudget::Usage(ConnectionPane *pane)
+{
+    return usage.value(pane);
+}
+
+qint64 MemoryBudget::Total()
+{
+    return total;
+}
+
+QStringList MemoryBudget::ReclaimLog()
+{
+    return reclaimLog;
+}
+
+void MemoryBudget::Measure()
+{
+    QHash<const CommandTree *, int> shared;
+    QHash<const CommandTree *, qint64> treeBytes;
+
+    foreach (ConnectionPane *pane, panes)
+        shared[pane->HelpTree()]++;
+
+    total = 0;
+
+    for (QHash<const CommandTree *, int>::const_iterator it = shared.constBegin() ; it != shared.constEnd() ; ++it)
+    {
+        treeBytes[it.key()] = it.key() ? it.key()->Bytes() : 0;
+        total += treeBytes[it.key()];
+    }
+
+    foreach (ConnectionPane *pane, panes)
+    {
+        SessionMemory m = pane->Memory();
+        m.Tree = treeBytes.value(pane->HelpTree());
+        m.TreeShared = shared.value(pane->HelpTree());
+
+        usage[pane] = m;
+        total += m.Own();
+    }
+}
+
+void MemoryBudget::Check()
+{
+    Measure();
+
+    qint64 limit = qint64(budget) * 1024 * 1024;
+
+    if (budget > 0 && total > limit)
+    {
+        qint64 freed = Reclaim(total - (limit * TargetPercent) / 100);
+
+        Measure();
+
+        QString message = QString("Memory over budget, %1 given back, %2 in use").arg(Size(freed)).arg(Size(total));
+        Log(message);
+        emit Reclaimed(message);
+    }
+
+    emit Measured();
+}
+
+// Trim the sessions viewed least recently first, then drop their output
+// altogether if that was not enough. Returns what was given back.
+qint64 MemoryBudget::Reclaim(qint64 excess)
+{
+    QList<ConnectionPane *> candidates;
+    foreach (ConnectionPane *pane, panes)
+    {
+        if (!pane->isVisible())
+            candidates.append(pane);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](ConnectionPane *a, ConnectionPane *b) -> bool {
+        return a->SinceViewed() > b->SinceViewed();
+    });
+
+    qint64 freed = 0;
+
+    for (int level = 1 ; level <= 2 && freed < excess ; level++)
+    {
+        foreach (ConnectionPane *pane, candidates)
+        {
+            if (freed >= excess)
+                break;
+
+            qint64 bytes = pane->Compact(level);
+            if (bytes <= 0)
+                continue;
+
+            freed += bytes;
+
+            Log(QString("%1: %2 %3").arg(pane->GetName())
+                .arg(level == 1 ? QString("trimmed output,") : QString("dropped output,"))
+                .arg(Size(bytes)));
+        }
+    }
+
+    if (freed < excess)
+        qWarning() << "Memory budget exceeded by" << Size(excess - freed) << "after trimming every session not on screen";
+
+    return freed;
+}
+
+void MemoryBudget::Log(QString message)
+{
+    reclaimLog.append(QDateTime::currentDateTime().toString("yyyy-MM-dd HH:mm:ss") + QString("  ") + message);
+
+    while (reclaimLog.size() > MaxLog)
+        reclaimLog.removeFirst();
+}
@@ -0,0 +1,80 @@
+#ifndef MEMORYBUDGET_H
+#define MEMORYBUDGET_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QStringList>
+
+class ConnectionPane;
+class QTimer;
+
+// What a session holds on to, in bytes. These are estimates from the
+// sizes of the containers, not counts from the allocator.
+struct SessionMemory
+{
+    SessionMemory() : Scrollback(0), Document(0), Lines(0), Tree(0), TreeShared(1) {}
+
+    // The HTML kept for redrawing, the text document shown, and the
+    // plain lines kept for the other views
+    qint64 Scrollback;
+    qint64 Document;
+    qint64 Lines;
+
+    // The help tree, and the number of sessions it is shared with
+    qint64 Tree;
+    int TreeShared;
+
+    qint64 Own() const { return Scrollback + Document + Lines; }
+};
+
+// Keeps account of the memory every console session uses and holds the
+// total under a budget. When it goes over, sessions give back their
+// output, those that have not been looked at for the longest first:
+// first they keep only the newest part of it, then only a note that it
+// was dropped. Sessions on screen are left alone. What was given back
+// is logged.
+//
+// Help trees are shared between sessions and stay, they count once.
+class MemoryBudget : public QObject
+{
+    Q_OBJECT
+
+public:
+    static MemoryBudget *Instance();
+    static QString Size(qint64 bytes);
+
+    void Register(ConnectionPane *pane);
+    void Unregister(ConnectionPane *pane);
+
+    void SetBudget(int megabytes);
+    int Budget();
+
+    QList<ConnectionPane *> Sessions();
+    SessionMemory Usage(ConnectionPane *pane);
+    qint64 Total();
+    QStringList ReclaimLog();
+
+public slots:
+    void Check();
+
+signals:
+    void Measured();
+    void Reclaimed(QString message);
+
+protected:
+    explicit MemoryBudget(QObject *parent = 0);
+
+    void Measure();
+    qint64 Reclaim(qint64 excess);
+    void Log(QString message);
+
+    QList<ConnectionPane *> panes;
+    QHash<ConnectionPane *, SessionMemory> usage;
+    QStringList reclaimLog;
+    QTimer *checkTimer;
+    qint64 total;
+    int budget;
+};
+
+#endif // MEMORYBUDGET_H
@@ -0,0 +1,148 @@
+#include "memoryview.h"
+#include "memorybudget.h"
+#include "connectionpane.h"
+
+#include <QVBoxLayout>
+#include <QSplitter>
+#include <QLabel>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QPlainTextEdit>
+#include <QScrollBar>
+
+enum Columns
+{
+    NameColumn,
+    ScrollbackColumn,
+    DocumentColumn,
+    LinesColumn,
+    TreeColumn,
+    TotalColumn,
+    ViewedColumn,
+    ColumnCount
+};
+
+// Sorts the size columns by the bytes behind the text
+class MemoryItem : public QTreeWidgetItem
+{
+public:
+    bool operator<(const QTreeWidgetItem &other) const
+    {
+        int column = treeWidget()->sortColumn();
+        if (column == NameColumn)
+            return QTreeWidgetItem::operator<(other);
+
+        return data(column, Qt::UserRole).toLongLong() < other.data(column, Qt::UserRole).toLongLong();
+    }
+};
+
+MemoryView::MemoryView(QWidget *parent) :
+    QWidget(parent)
+{
+    QVBoxLayout *layout = new QVBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    summary = new QLabel(this);
+    layout->addWidget(summary);
+
+    QSplitter *splitter = new QSplitter(Qt::Vertical, this);
+    layout->addWidget(splitter);
+
+    sessions = new QTreeWidget(splitter);
+    sessions->setRootIsDecorated(false);
+    sessions->setColumnCount(ColumnCount);
+    sessions->setHeaderLabels(QStringList() << "Session" << "Scrollback" << "Document" << "Lines" << "Help tree" << "Total" << "Last viewed");
+    sessions->header()->setSectionResizeMode(NameColumn, QHeaderView::Stretch);
+    sessions->setSortingEnabled(true);
+    sessions->sortByColumn(TotalColumn, Qt::DescendingOrder);
+    connect(sessions, SIGNAL(itemActivated(QTreeWidgetItem *, int)), this, SLOT(ItemActivated(QTreeWidgetItem *)));
+
+    log = new QPlainTextEdit(splitter);
+    log->setReadOnly(true);
+
+    splitter->setSizes(QList<int>() << 400 << 150);
+
+    connect(MemoryBudget::Instance(), SIGNAL(Measured()), this, SLOT(Refresh()));
+}
+
+void MemoryView::showEvent(QShowEvent *event)
+{
+    QWidget::showEvent(event);
+
+    MemoryBudget::Instance()->Check();
+}
+
+void MemoryView::Refresh()
+{
+    if (!isVisible())
+        return;
+
+    MemoryBudget *budget = MemoryBudget::Instance();
+
+    if (budget->Budget() > 0)
+        summary->setText(QString("%1 in use of %2").arg(MemoryBudget::Size(budget->Total())).arg(MemoryBudget::Size(qint64(budget->Budget()) * 1024 * 1024)));
+    else
+        summary->setText(QString("%1 in use, no budget set").arg(MemoryBudget::Size(budget->Total())));
+
+    sessions->setSortingEnabled(false);
+    sessions->clear();
+
+    foreach (ConnectionPane *pane, budget->Sessions())
+    {
+        // Panes waiting in the pool for a connection
+        if (pane->GetName().isEmpty())
+            continue;
+
+        SessionMemory m = budget->Usage(pane);
+
+        qint64 values[ColumnCount];
+        values[ScrollbackColumn] = m.Scrollback;
+        values[DocumentColumn] = m.Document;
+        values[LinesColumn] = m.Lines;
+        values[TreeColumn] = m.Tree / qMax(1, m.TreeShared);
+        values[TotalColumn] = m.Own() + values[TreeColumn];
+        values[ViewedColumn] = pane->SinceViewed();
+
+        MemoryItem *item = new MemoryItem();
+        item->setText(NameColumn, pane->GetName());
+        item->setData(NameColumn, Qt::UserRole, qVariantFromValue((void *)pane));
+
+        for (int c = ScrollbackColumn ; c <= TotalColumn ; c++)
+        {
+            item->setText(c, MemoryBudget::Size(values[c]));
+            item->setData(c, Qt::UserRole, values[c]);
+            item->setTextAlignment(c, Qt::AlignRight | Qt::AlignVCenter);
+        }
+
+        // The tree's share, the whole tree is in the tooltip
+        if (m.TreeShared > 1)
+            item->setToolTip(TreeColumn, QString("%1 shared by %2 sessions").arg(MemoryBudget::Size(m.Tree)).arg(m.TreeShared));
+
+        qint64 viewed = values[ViewedColumn] / 1000;
+        item->setText(ViewedColumn, viewed == 0 ? QString("now") : QString("%1:%2:%3 ago").arg(viewed / 3600).arg((viewed / 60) % 60, 2, 10, QChar('0')).arg(viewed % 60, 2, 10, QChar('0')));
+        item->setData(ViewedColumn, Qt::UserRole, values[ViewedColumn]);
+
+        sessions->addTopLevelItem(item);
+    }
+
+    sessions->setSortingEnabled(true);
+
+    // The log only grows at the end, redraw it when the end moved
+    QStringList entries = budget->ReclaimLog();
+    if (!entries.isEmpty() && entries.last() != lastEntry)
+    {
+        lastEntry = entries.last();
+
+        log->setPlainText(entries.join("\n"));
+        log->verticalScrollBar()->setValue(log->verticalScrollBar()->maximum());
+    }
+}
+
+void MemoryView::ItemActivated(QTreeWidgetItem *item)
+{
+    ConnectionPane *pane = (ConnectionPane *)item->data(NameColumn, Qt::UserRole).value<void *>();
+
+    // It may have been closed since
+    if (MemoryBudget::Instance()->Sessions().contains(pane))
+        emit Activated(pane);
+}
@@ -0,0 +1,37 @@
+#ifndef MEMORYVIEW_H
+#define MEMORYVIEW_H
+
+#include <QWidget>
+
+class ConnectionPane;
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QPlainTextEdit;
+
+// What every session holds, as the memory budget last measured it, and
+// what the budget has given back so far
+class MemoryView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MemoryView(QWidget *parent = 0);
+
+signals:
+    void Activated(ConnectionPane *pane);
+
+protected slots:
+    void Refresh();
+    void ItemActivated(QTreeWidgetItem *item);
+
+protected:
+    void showEvent(QShowEvent *event);
+
+    QLabel *summary;
+    QTreeWidget *sessions;
+    QPlainTextEdit *log;
+    QString lastEntry;
+};
+
+#endif // MEMORYVIEW_H
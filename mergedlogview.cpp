@@ -0,0 +1,255 @@
+#include "mergedlogview.h"
+#include "connectionpane.h"
+#include "linebuffer.h"
+#include "panetheme.h"
+
+#include <QHBoxLayout>
+#include <QSplitter>
+#include <QListWidget>
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QTextCursor>
+#include <QTextCharFormat>
+#include <QDateTime>
+#include <QTimer>
+
+#include <algorithm>
+
+// Lines kept in the merged log
+static const int MaxLines = 10000;
+
+// Lines of each session taken over when the selection changes
+static const int Backlog = 1000;
+
+static const QRgb SourceColors[] = {
+    0x0000ff, 0x00a000, 0xc000c0, 0x008080, 0xc06000, 0x6060c0, 0xa00000, 0x808000
+};
+
+MergedLogView::MergedLogView(QWidget *parent) :
+    QWidget(parent),
+    colors(0),
+    updating(false)
+{
+    QHBoxLayout *layout = new QHBoxLayout(this);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    QSplitter *splitter = new QSplitter(this);
+    layout->addWidget(splitter);
+
+    list = new QListWidget(splitter);
+    connect(list, SIGNAL(itemChanged(QListWidgetItem *)), this, SLOT(SelectionChanged(QListWidgetItem *)));
+
+    log = new QPlainTextEdit(splitter);
+    log->setReadOnly(true);
+    log->setMaximumBlockCount(MaxLines);
+    log->setFont(PaneTheme::Current().Font);
+    log->setPalette(PaneTheme::Current().Palette);
+
+    splitter->setStretchFactor(0, 0);
+    splitter->setStretchFactor(1, 1);
+    splitter->setSizes(QList<int>() << 150 << 600);
+
+    mergeTimer = new QTimer(this);
+    mergeTimer->setSingleShot(true);
+    mergeTimer->setInterval(0);
+    connect(mergeTimer, SIGNAL(timeout()), this, SLOT(Merge()));
+}
+
+// Sessions that are still open keep their place in the log. New ones
+// join with the lines that come from now on.
+void MergedLogView::SetPanes(QList<ConnectionPane *> panes)
+{
+    QList<Source> kept;
+
+    foreach (ConnectionPane *pane, panes)
+    {
+        bool found = false;
+
+        for (int i = 0 ; i < sources.size() ; i++)
+        {
+            if (sources.at(i).Pane == pane)
+            {
+                kept.append(sources.at(i));
+                found = true;
+                break;
+            }
+        }
+
+        if (found)
+            continue;
+
+        Source s;
+        s.Pane = pane;
+        s.Color = QColor(SourceColors[colors++ % (sizeof(SourceColors) / sizeof(SourceColors[0]))]);
+        s.Next = pane->Lines().NextSeq();
+        s.Selected = true;
+        kept.append(s);
+
+        connect(pane, SIGNAL(LinesAdded()), this, SLOT(ScheduleMerge()), Qt::UniqueConnection);
+    }
+
+    sources = kept;
+
+    updating = true;
+    list->clear();
+    foreach (const Source &s, sources)
+    {
+        QListWidgetItem *item = new QListWidgetItem(s.Pane->GetName(), list);
+        item->setForeground(s.Color);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(s.Selected ? Qt::Checked : Qt::Unchecked);
+    }
+    updating = false;
+
+    ScheduleMerge();
+}
+
+void MergedLogView::SelectionChanged(QListWidgetItem *item)
+{
+    if (updating)
+        return;
+
+    int row = list->row(item);
+    if (row < 0 || row >= sources.size())
+        return;
+
+    sources[row].Selected = item->checkState() == Qt::Checked;
+
+    Restart();
+}
+
+// Merge again from the recent lines of the selected sessions, rather
+// than slotting a session's old lines in between those already shown
+void MergedLogView::Restart()
+{
+    log->clear();
+
+    for (int i = 0 ; i < sources.size() ; i++)
+    {
+        Source &s = sources[i];
+        if (!s.Pane)
+            continue;
+
+        const LineBuffer &lines = s.Pane->Lines();
+
+        s.Next = lines.FirstSeq();
+        if (lines.NextSeq() - s.Next > quint64(Backlog))
+            s.Next = lines.NextSeq() - Backlog;
+    }
+
+    Merge();
+}
+
+void MergedLogView::ScheduleMerge()
+{
+    if (!mergeTimer->isActive())
+        mergeTimer->start();
+}
+
+// Ordered by arrival, the heap's top is the earliest
+bool MergedLogView::Later(const Head &a, const Head &b)
+{
+    if (a.Time != b.Time)
+        return a.Time > b.Time;
+
+    return a.Source > b.Source;
+}
+
+// The next line a session has for the log. Lines that dropped out of
+// the session's buffer before they were merged are skipped.
+bool MergedLogView::Pending(int source, Head *head)
+{
+    Source &s = sources[source];
+    if (!s.Selected || !s.Pane)
+        return false;
+
+    const LineBuffer &lines = s.Pane->Lines();
+
+    if (s.Next < lines.FirstSeq())
+        s.Next = lines.FirstSeq();
+    if (s.Next >= lines.NextSeq())
+        return false;
+
+    head->Time = lines.At(lines.IndexOf(s.Next)).Time;
+    head->Source = source;
+
+    return true;
+}
+
+void MergedLogView::Merge()
+{
+    heap.clear();
+
+    for (int i = 0 ; i < sources.size() ; i++)
+    {
+        Head h;
+        if (Pending(i, &h))
+            heap.append(h);
+    }
+
+    if (heap.isEmpty())
+        return;
+
+    std::make_heap(heap.begin(), heap.end(), Later);
+
+    QScrollBar *bar = log->verticalScrollBar();
+    bool atEnd = bar->value() == bar->maximum();
+
+    QTextCharFormat plain;
+    QTextCharFormat prefix;
+    prefix.setFontWeight(QFont::Bold);
+    QTextCharFormat text;
+
+    QTextCursor cursor(log->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+
+    while (!heap.isEmpty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), Later);
+        Head h = heap.last();
+        heap.removeLast();
+
+        Source &s = sources[h.Source];
+        const LineBuffer &lines = s.Pane->Lines();
+        const ConsoleLine &line = lines.At(lines.IndexOf(s.Next));
+
+        if (!log->document()->isEmpty())
+            cursor.insertBlock();
+
+        cursor.insertText(QDateTime::fromMSecsSinceEpoch(line.Time).toString("HH:mm:ss.zzz "), plain);
+
+        prefix.setForeground(s.Color);
+        cursor.insertText(QString("[") + s.Pane->GetName() + QString("] "), prefix);
+
+        switch (line.Level)
+        {
+        case ConsoleLine::Error:
+            text.setForeground(QColor(0xff, 0x00, 0x00));
+            break;
+        case ConsoleLine::Warn:
+            text.setForeground(QColor(0xcf, 0xcf, 0x00));
+            break;
+        case ConsoleLine::Command:
+            text.setForeground(QColor(0x00, 0x00, 0xff));
+            break;
+        default:
+            text.clearForeground();
+            break;
+        }
+        cursor.insertText(line.Text, text);
+
+        s.Next++;
+
+        if (Pending(h.Source, &h))
+        {
+            heap.append(h);
+            std::push_heap(heap.begin(), heap.end(), Later);
+        }
+    }
+
+    cursor.endEditBlock();
+
+    if (atEnd)
+        bar->setValue(bar->maximum());
+}
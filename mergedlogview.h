@@ -0,0 +1,62 @@
+#ifndef MERGEDLOGVIEW_H
+#define MERGEDLOGVIEW_H
+
+#include <QWidget>
+#include <QList>
+#include <QVector>
+#include <QPointer>
+#include <QColor>
+
+class ConnectionPane;
+class QListWidget;
+class QListWidgetItem;
+class QPlainTextEdit;
+class QTimer;
+
+// The output of several consoles as one log, in the order the lines
+// arrived. Every session's lines are already in order, so new lines are
+// merged through a heap holding the next line of each session. The log
+// keeps a fixed number of lines and drops the oldest.
+class MergedLogView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit MergedLogView(QWidget *parent = 0);
+
+    void SetPanes(QList<ConnectionPane *> panes);
+
+protected slots:
+    void ScheduleMerge();
+    void Merge();
+    void SelectionChanged(QListWidgetItem *item);
+
+protected:
+    struct Source
+    {
+        QPointer<ConnectionPane> Pane;
+        QColor Color;
+        quint64 Next;
+        bool Selected;
+    };
+
+    struct Head
+    {
+        qint64 Time;
+        int Source;
+    };
+
+    static bool Later(const Head &a, const Head &b);
+    void Restart();
+    bool Pending(int source, Head *head);
+
+    QList<Source> sources;
+    QVector<Head> heap;
+    QListWidget *list;
+    QPlainTextEdit *log;
+    QTimer *mergeTimer;
+    int colors;
+    bool updating;
+};
+
+#endif // MERGEDLOGVIEW_H
@@ -0,0 +1,84 @@
+#include "metricextractor.h"
+
+#include <QDebug>
+
+static MetricExtractor extractor;
+static bool configured = false;
+
+const MetricExtractor &MetricExtractor::Current()
+{
+    if (!configured)
+        SetRules(DefaultRules());
+
+    return extractor;
+}
+
+// Values from the output of "show stats"
+QStringList MetricExtractor::DefaultRules()
+{
+    return QStringList()
+            << "FrameTime = frame ?time\\D*?(\\d+(?:\\.\\d+)?)"
+            << "Agents = root ?agents?\\D*?(\\d+)"
+            << "Prims = prims\\D*?(\\d+)"
+            << "ScriptEvents = script ?events\\D*?(\\d+(?:\\.\\d+)?)";
+}
+
+void MetricExtractor::SetRules(QStringList rules)
+{
+    extractor.rules.clear();
+    configured = true;
+
+    foreach (QString text, rules)
+    {
+        int eq = text.indexOf('=');
+        if (eq < 0)
+            continue;
+
+        Rule rule;
+        rule.Field = text.left(eq).trimmed();
+        rule.Pattern = QRegularExpression(text.mid(eq + 1).trimmed(), QRegularExpression::CaseInsensitiveOption);
+
+        if (rule.Field.isEmpty() || rule.Pattern.pattern().isEmpty())
+            continue;
+
+        if (!rule.Pattern.isValid() || rule.Pattern.captureCount() < 1)
+        {
+            qWarning() << "Metric rule" << text << "needs a valid expression with a group for the value";
+            continue;
+        }
+
+        rule.Pattern.optimize();
+        extractor.rules.append(rule);
+    }
+}
+
+bool MetricExtractor::IsEmpty() const
+{
+    return rules.isEmpty();
+}
+
+QList<QPair<QString, float> > MetricExtractor::Extract(const QString &line) const
+{
+    QList<QPair<QString, float> > values;
+
+    // A line without a digit has no value to give
+    bool digit = false;
+    for (int i = 0 ; i < line.size() && !digit ; i++)
+        digit = line.at(i).isDigit();
+    if (!digit)
+        return values;
+
+    foreach (const Rule &rule, rules)
+    {
+        QRegularExpressionMatch m = rule.Pattern.match(line);
+        if (!m.hasMatch())
+            continue;
+
+        bool ok = false;
+        float value = m.captured(1).toFloat(&ok);
+        if (ok)
+            values.append(qMakePair(rule.Field, value));
+    }
+
+    return values;
+}
@@ -0,0 +1,33 @@
+#ifndef METRICEXTRACTOR_H
+#define METRICEXTRACTOR_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QRegularExpression>
+
+// Takes numbers out of console lines. Each rule is written as
+// "Field = expression", and the first group the expression captures is
+// the value. The rules are shared by all consoles.
+class MetricExtractor
+{
+public:
+    static const MetricExtractor &Current();
+    static void SetRules(QStringList rules);
+    static QStringList DefaultRules();
+
+    QList<QPair<QString, float> > Extract(const QString &line) const;
+    bool IsEmpty() const;
+
+protected:
+    struct Rule
+    {
+        QString Field;
+        QRegularExpression Pattern;
+    };
+
+    QList<Rule> rules;
+};
+
+#endif // METRICEXTRACTOR_H
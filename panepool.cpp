@@ -0,0 +1,101 @@
+#include "panepool.h"
+#include "connectionpane.h"
+
+#include <QCoreApplication>
+#include <QTimer>
+#include <QVariant>
+
+// Closing a lot of tabs shouldn't keep a lot of panes alive
+static const int MaxSpares = 8;
+
+PanePool *PanePool::Instance()
+{
+    static PanePool *instance = 0;
+
+    if (instance == 0)
+        instance = new PanePool(QCoreApplication::instance());
+
+    return instance;
+}
+
+PanePool::PanePool(QObject *parent) :
+    QObject(parent),
+    wanted(0),
+    building(false)
+{
+}
+
+// Spares have no parent widget, nothing else deletes them
+PanePool::~PanePool()
+{
+    qDeleteAll(spares);
+}
+
+ConnectionPane *PanePool::Take(ConnectionData *c, QHostAddress addr, QWidget *parent)
+{
+    if (spares.isEmpty())
+        return new ConnectionPane(c, addr, parent);
+
+    ConnectionPane *pane = spares.takeLast();
+    pane->setParent(parent);
+    pane->Setup(c, addr);
+
+    return pane;
+}
+
+// Takes the pane out of its tab and keeps it, or deletes it if there
+// are enough spares already
+void PanePool::Recycle(ConnectionPane *pane)
+{
+    if (spares.size() >= MaxSpares)
+    {
+        pane->CloseConnection();
+        delete pane;
+        return;
+    }
+
+    pane->Reset();
+    pane->hide();
+    pane->setParent(0);
+    pane->setProperty("UUID", QVariant());
+
+    spares.append(pane);
+}
+
+// Build spares while the application is idle, one per turn of the event
+// loop so the window stays responsive
+void PanePool::Prewarm(int count)
+{
+    if (count > MaxSpares)
+        count = MaxSpares;
+
+    wanted = count;
+
+    if (!building && spares.size() < wanted)
+    {
+        building = true;
+        QTimer::singleShot(0, this, SLOT(BuildSpare()));
+    }
+}
+
+void PanePool::BuildSpare()
+{
+    if (spares.size() < wanted)
+        spares.append(new ConnectionPane());
+
+    building = spares.size() < wanted;
+    if (building)
+        QTimer::singleShot(0, this, SLOT(BuildSpare()));
+}
+
+// Spares pick up a changed theme now rather than when they are taken
+void PanePool::ApplyTheme()
+{
+    foreach (ConnectionPane *pane, spares)
+        pane->ApplyTheme();
+}
+
+int PanePool::Spares()
+{
+    return spares.size();
+}
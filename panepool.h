@@ -0,0 +1,41 @@
+#ifndef PANEPOOL_H
+#define PANEPOOL_H
+
+#include <QObject>
+#include <QList>
+#include <QHostAddress>
+
+class ConnectionPane;
+class ConnectionData;
+class QWidget;
+
+// Console panes that were closed, kept to be used again. Building a
+// pane means building its whole widget tree, reusing one only means
+// pointing it at another connection.
+class PanePool : public QObject
+{
+    Q_OBJECT
+
+public:
+    static PanePool *Instance();
+
+    ~PanePool();
+
+    ConnectionPane *Take(ConnectionData *c, QHostAddress addr, QWidget *parent);
+    void Recycle(ConnectionPane *pane);
+    void Prewarm(int count);
+    void ApplyTheme();
+    int Spares();
+
+protected slots:
+    void BuildSpare();
+
+protected:
+    explicit PanePool(QObject *parent = 0);
+
+    QList<ConnectionPane *> spares;
+    int wanted;
+    bool building;
+};
+
+#endif // PANEPOOL_H
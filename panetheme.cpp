@@ -0,0 +1,69 @@
+#include "panetheme.h"
+
+#include <QFontDatabase>
+#include <QSettings>
+#include <QColor>
+
+static PaneTheme theme;
+static bool resolved = false;
+static int generation = 0;
+
+const PaneTheme &PaneTheme::Current()
+{
+    if (!resolved)
+    {
+        theme.Resolve();
+        resolved = true;
+    }
+
+    return theme;
+}
+
+// Called when the preferences change
+void PaneTheme::Invalidate()
+{
+    resolved = false;
+}
+
+// Registering the font again would add another copy to the database
+QString PaneTheme::ConsoleFamily()
+{
+    static QString family;
+    static bool registered = false;
+
+    if (!registered)
+    {
+        registered = true;
+
+        int id = QFontDatabase::addApplicationFont(":/fonts/Consolas.ttf");
+        QStringList families = QFontDatabase::applicationFontFamilies(id);
+        if (!families.isEmpty())
+            family = families.at(0);
+    }
+
+    return family;
+}
+
+void PaneTheme::Resolve()
+{
+    QSettings settings;
+
+    Generation = ++generation;
+
+    Font = QFont();
+    if (!settings.value("system_font", false).toBool() && !ConsoleFamily().isEmpty())
+        Font.setFamily(ConsoleFamily());
+    Font.setPointSize(18);
+
+    QColor background(0xfc, 0xfc, 0xfc);
+    QColor text(Qt::black);
+    if (settings.value("black_on_white", false).toBool())
+    {
+        background = QColor(Qt::black);
+        text = QColor(Qt::white);
+    }
+
+    Palette = QPalette();
+    Palette.setColor(QPalette::Base, background);
+    Palette.setColor(QPalette::Text, text);
+}
@@ -0,0 +1,26 @@
+#ifndef PANETHEME_H
+#define PANETHEME_H
+
+#include <QFont>
+#include <QPalette>
+
+// Font and colors of the console panes. They are worked out once and
+// shared, so opening a pane doesn't read the settings or register the
+// console font again.
+class PaneTheme
+{
+public:
+    static const PaneTheme &Current();
+    static void Invalidate();
+
+    // Changes whenever the theme is worked out again
+    int Generation;
+    QFont Font;
+    QPalette Palette;
+
+protected:
+    static QString ConsoleFamily();
+    void Resolve();
+};
+
+#endif // PANETHEME_H
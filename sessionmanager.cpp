@@ -0,0 +1,175 @@
+#include "sessionmanager.h"
+#include "connectionpane.h"
+
+#include <QCoreApplication>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QUrlQuery>
+#include <QDomDocument>
+#include <QDomElement>
+#include <QDomNodeList>
+#include <QEventLoop>
+#include <QTimer>
+#include <QDebug>
+
+SessionManager *SessionManager::Instance()
+{
+    static SessionManager *instance = 0;
+
+    if (instance == 0)
+        instance = new SessionManager(QCoreApplication::instance());
+
+    return instance;
+}
+
+SessionManager::SessionManager(QObject *parent) :
+    QObject(parent),
+    idleTimeout(0)
+{
+    // The close requests need to outlive the panes that send them,
+    // so they go through a manager of our own.
+    manager = new QNetworkAccessManager(this);
+
+    idleTimer = new QTimer(this);
+    idleTimer->setInterval(30000);
+    connect(idleTimer, SIGNAL(timeout()), this, SLOT(CheckIdle()));
+}
+
+void SessionManager::Register(ConnectionPane *pane)
+{
+    if (!sessions.contains(pane))
+        sessions.append(pane);
+}
+
+void SessionManager::Unregister(ConnectionPane *pane)
+{
+    sessions.removeAll(pane);
+}
+
+// Tell the simulator to drop a console session and its line buffer.
+void SessionManager::CloseSession(QUrl url, QString sessionID, QString name)
+{
+    if (sessionID.isEmpty())
+        return;
+
+    QUrlQuery queryString;
+
+    queryString.addQueryItem("ID", sessionID);
+
+    QString data = queryString.query(QUrl::FullyEncoded).toUtf8();
+
+    QNetworkRequest request(url);
+    request.setHeader(QNetworkRequest::ContentTypeHeader, QVariant("application/x-www-form-urlencoded"));
+
+    QNetworkReply *reply = manager->post(request, data.toLatin1());
+    pendingCloses[reply] = name;
+    connect(reply, SIGNAL(finished()), this, SLOT(CloseReply()));
+}
+
+void SessionManager::CloseReply()
+{
+    QNetworkReply *reply = qobject_cast<QNetworkReply *>(sender());
+    if (!reply)
+        return;
+
+    QString name = pendingCloses.take(reply);
+
+    if (reply->error() != QNetworkReply::NoError)
+    {
+        QString message = QString("Closing session on %1 failed: %2").arg(name).arg(reply->errorString());
+        qWarning() << message;
+        emit Report(message);
+    }
+    else
+    {
+        QDomDocument doc;
+        doc.setContent(reply->readAll(), false);
+
+        QDomNodeList resultL = doc.documentElement().elementsByTagName(QString("Result"));
+        if (resultL.count() == 0 || resultL.at(0).toElement().text() != QString("OK"))
+        {
+            QString message = QString("Simulator %1 did not confirm closing the session").arg(name);
+            qWarning() << message;
+            emit Report(message);
+        }
+    }
+
+    reply->deleteLater();
+
+    if (pendingCloses.isEmpty())
+        emit AllClosed();
+}
+
+// Close all live sessions and wait up to deadline milliseconds for
+// the simulators to confirm. Anything still outstanding is reported
+// as leaked.
+void SessionManager::CloseAll(int deadline)
+{
+    QList<ConnectionPane *> live = sessions;
+    foreach (ConnectionPane *pane, live)
+        pane->CloseSession(QString());
+
+    if (pendingCloses.isEmpty())
+        return;
+
+    QEventLoop loop;
+    QTimer timer;
+    timer.setSingleShot(true);
+    connect(&timer, SIGNAL(timeout()), &loop, SLOT(quit()));
+    connect(this, SIGNAL(AllClosed()), &loop, SLOT(quit()));
+
+    timer.start(deadline);
+    loop.exec();
+
+    QList<QNetworkReply *> leaked = pendingCloses.keys();
+    foreach (QNetworkReply *reply, leaked)
+    {
+        qWarning() << "Session on" << pendingCloses[reply] << "was not closed before exit and may have leaked";
+
+        disconnect(reply, 0, this, 0);
+        reply->abort();
+        reply->deleteLater();
+    }
+    pendingCloses.clear();
+}
+
+void SessionManager::SetIdleTimeout(int minutes)
+{
+    idleTimeout = minutes;
+
+    if (idleTimeout > 0)
+        idleTimer->start();
+    else
+        idleTimer->stop();
+}
+
+int SessionManager::IdleTimeout()
+{
+    return idleTimeout;
+}
+
+QStringList SessionManager::LiveSessions()
+{
+    QStringList names;
+
+    foreach (ConnectionPane *pane, sessions)
+        names.append(pane->GetName());
+
+    return names;
+}
+
+void SessionManager::CheckIdle()
+{
+    if (idleTimeout <= 0)
+        return;
+
+    qint64 limit = qint64(idleTimeout) * 60000;
+
+    QList<ConnectionPane *> live = sessions;
+    foreach (ConnectionPane *pane, live)
+    {
+        if (pane->IdleTime() > limit)
+            pane->CloseSession(QString("Disconnected after %1 minutes idle").arg(idleTimeout));
+    }
+}
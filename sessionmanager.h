@@ -0,0 +1,51 @@
+#ifndef SESSIONMANAGER_H
+#define SESSIONMANAGER_H
+
+#include <QObject>
+#include <QList>
+#include <QMap>
+#include <QUrl>
+#include <QString>
+#include <QStringList>
+
+class ConnectionPane;
+class QNetworkAccessManager;
+class QNetworkReply;
+class QTimer;
+
+// Keeps track of every console session that is logged in on a simulator
+// and makes sure it is closed there as well, not just on our side.
+class SessionManager : public QObject
+{
+    Q_OBJECT
+
+public:
+    static SessionManager *Instance();
+
+    void Register(ConnectionPane *pane);
+    void Unregister(ConnectionPane *pane);
+    void CloseSession(QUrl url, QString sessionID, QString name);
+    void CloseAll(int deadline);
+    void SetIdleTimeout(int minutes);
+    int IdleTimeout();
+    QStringList LiveSessions();
+
+signals:
+    void Report(QString message);
+    void AllClosed();
+
+protected slots:
+    void CloseReply();
+    void CheckIdle();
+
+protected:
+    explicit SessionManager(QObject *parent = 0);
+
+    QNetworkAccessManager *manager;
+    QList<ConnectionPane *> sessions;
+    QMap<QNetworkReply *, QString> pendingCloses;
+    QTimer *idleTimer;
+    int idleTimeout;
+};
+
+#endif // SESSIONMANAGER_H
@@ -1,7 +1,7 @@
 #include "splashdialog.h"
 #include "ui_splashdialog.h"
 #include <QPainter>
-#include <QImage>
+#include <QPixmap>
 #include <QTimer>
 
 SplashDialog::SplashDialog(QWidget *parent, Qt::WindowFlags f) :
@@ -28,12 +28,19 @@ void SplashDialog::show()
 
 }
 
+// Decoded once, the first time it is painted
+static const QPixmap &splashPixmap()
+{
+    static QPixmap pixmap(":/Icons/Splash.png");
+
+    return pixmap;
+}
+
 void SplashDialog::paintEvent(QPaintEvent *)
 {
     QPainter p(this);
-    QImage img(":/Icons/Splash.png");
 
-    p.drawImage(0, 0, img);
+    p.drawPixmap(0, 0, splashPixmap());
 
     if (isSplash)
     {
@@ -0,0 +1,60 @@
+#include "startuptimeline.h"
+
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QList>
+
+struct TimelineMark
+{
+    QString Phase;
+    qint64 Nanoseconds;
+};
+
+static QElapsedTimer timer;
+static QList<TimelineMark> marks;
+static bool finished = false;
+
+void StartupTimeline::Start()
+{
+    timer.start();
+    marks.clear();
+    finished = false;
+}
+
+void StartupTimeline::Mark(QString phase)
+{
+    if (finished || !timer.isValid())
+        return;
+
+    TimelineMark m;
+    m.Phase = phase;
+    m.Nanoseconds = timer.nsecsElapsed();
+    marks.append(m);
+}
+
+void StartupTimeline::Finish()
+{
+    Mark("Startup complete");
+    finished = true;
+}
+
+// One line per phase: time since start, time the phase took, phase
+QString StartupTimeline::Report()
+{
+    QStringList lines;
+    qint64 last = 0;
+
+    foreach (TimelineMark m, marks)
+    {
+        lines.append(QString("%1 ms  %2 ms  %3")
+                     .arg(m.Nanoseconds / 1000000.0, 9, 'f', 1)
+                     .arg((m.Nanoseconds - last) / 1000000.0, 8, 'f', 1)
+                     .arg(m.Phase));
+        last = m.Nanoseconds;
+    }
+
+    if (!finished)
+        lines.append(QString("Startup still in progress"));
+
+    return lines.join("\n");
+}
@@ -0,0 +1,18 @@
+#ifndef STARTUPTIMELINE_H
+#define STARTUPTIMELINE_H
+
+#include <QString>
+
+// Time spent in each phase of startup. Start() is called first thing in
+// main(), each phase calls Mark() when it is done and Finish() ends the
+// timeline. Marks after that are ignored.
+class StartupTimeline
+{
+public:
+    static void Start();
+    static void Mark(QString phase);
+    static void Finish();
+    static QString Report();
+};
+
+#endif // STARTUPTIMELINE_H
@@ -0,0 +1,154 @@
+#include "timerwheel.h"
+
+TimerWheel::TimerWheel() :
+    current(0),
+    slots(Levels * Slots)
+{
+
+}
+
+qint64 TimerWheel::Now() const
+{
+    return current;
+}
+
+int TimerWheel::Count() const
+{
+    return entries.size();
+}
+
+bool TimerWheel::Contains(quint64 key) const
+{
+    return entries.contains(key);
+}
+
+void TimerWheel::Clear()
+{
+    for (int i = 0 ; i < slots.size() ; i++)
+        slots[i].clear();
+    overflow.clear();
+    entries.clear();
+}
+
+// A key scheduled again moves to its new deadline
+void TimerWheel::Schedule(quint64 key, qint64 due)
+{
+    Cancel(key);
+
+    // Anything already due goes off with the next tick
+    if (due <= current)
+        due = current + 1;
+
+    Place(key, due, 0);
+}
+
+void TimerWheel::Cancel(quint64 key)
+{
+    QHash<quint64, Entry>::iterator it = entries.find(key);
+    if (it == entries.end())
+        return;
+
+    if (it.value().Slot < 0)
+        overflow.remove(key);
+    else
+        slots[it.value().Slot].remove(key);
+
+    entries.erase(it);
+}
+
+// The level is picked by the highest bit in which the deadline differs
+// from the current tick, so a slot only ever holds keys that come due
+// in the same turn of the level below it.
+void TimerWheel::Place(quint64 key, qint64 due, QList<quint64> *expired)
+{
+    if (due <= current)
+    {
+        if (expired)
+            expired->append(key);
+        return;
+    }
+
+    Entry entry;
+    entry.Due = due;
+    entry.Slot = -1;
+
+    quint64 diff = quint64(due) ^ quint64(current);
+
+    for (int level = 0 ; level < Levels ; level++)
+    {
+        if (diff < (quint64(1) << (Bits * (level + 1))))
+        {
+            int slot = int((quint64(due) >> (Bits * level)) & (Slots - 1));
+            entry.Slot = level * Slots + slot;
+            break;
+        }
+    }
+
+    if (entry.Slot < 0)
+        overflow.insert(key);
+    else
+        slots[entry.Slot].insert(key);
+
+    entries[key] = entry;
+}
+
+// Spread a slot of a level over the levels below it
+void TimerWheel::Cascade(int level, QList<quint64> *expired)
+{
+    int slot = int((quint64(current) >> (Bits * level)) & (Slots - 1));
+
+    QSet<quint64> keys;
+    keys.swap(slots[level * Slots + slot]);
+
+    foreach (quint64 key, keys)
+        Place(key, entries.take(key).Due, expired);
+}
+
+// Move the wheel forward and return the keys that came due, each one
+// once. They are no longer scheduled afterwards.
+QList<quint64> TimerWheel::Advance(qint64 now)
+{
+    QList<quint64> expired;
+
+    while (current < now)
+    {
+        // Nothing left, so the ticks in between don't matter
+        if (entries.isEmpty())
+        {
+            current = now;
+            break;
+        }
+
+        current++;
+
+        // Each time a level wraps, the next slot up comes down
+        int level = 1;
+        while (level < Levels && (quint64(current) & ((quint64(1) << (Bits * level)) - 1)) == 0)
+        {
+            Cascade(level, &expired);
+            level++;
+        }
+
+        if (level == Levels && (quint64(current) & ((quint64(1) << (Bits * Levels)) - 1)) == 0)
+        {
+            QSet<quint64> keys;
+            keys.swap(overflow);
+
+            foreach (quint64 key, keys)
+                Place(key, entries.take(key).Due, &expired);
+        }
+
+        int slot = int(quint64(current) & (Slots - 1));
+
+        QSet<quint64> due;
+        due.swap(slots[slot]);
+
+        foreach (quint64 key, due)
+        {
+            entries.remove(key);
+            expired.append(key);
+        }
+    }
+
+    return expired;
+}
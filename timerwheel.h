@@ -0,0 +1,54 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QVector>
+
+// Deadlines for many keys at once, in whole ticks. Four levels of 64
+// slots cover 64^4 ticks; a key goes into the coarsest level its
+// deadline needs and moves down a level each time that slot comes
+// round, so scheduling, cancelling and advancing one tick cost the
+// same however many keys there are. Deadlines beyond the last level
+// wait in an overflow list.
+class TimerWheel
+{
+public:
+    TimerWheel();
+
+    void Schedule(quint64 key, qint64 due);
+    void Cancel(quint64 key);
+    void Clear();
+    bool Contains(quint64 key) const;
+    int Count() const;
+    qint64 Now() const;
+
+    QList<quint64> Advance(qint64 now);
+
+protected:
+    enum
+    {
+        Bits = 6,
+        Slots = 1 << Bits,
+        Levels = 4
+    };
+
+    struct Entry
+    {
+        qint64 Due;
+
+        // Level * Slots + slot, or -1 for the overflow list
+        int Slot;
+    };
+
+    void Place(quint64 key, qint64 due, QList<quint64> *expired);
+    void Cascade(int level, QList<quint64> *expired);
+
+    qint64 current;
+    QVector<QSet<quint64> > slots;
+    QSet<quint64> overflow;
+    QHash<quint64, Entry> entries;
+};
+
+#endif // TIMERWHEEL_H
@@ -0,0 +1,86 @@
+#include "timeseries.h"
+
+TimeSeries::TimeSeries() :
+    last(0),
+    lastTime(0)
+{
+    for (int l = 0 ; l < Levels ; l++)
+    {
+        levels[l].Head = 0;
+        levels[l].Count = 0;
+        levels[l].Sum = 0;
+        levels[l].Pending = 0;
+    }
+}
+
+void TimeSeries::Add(qint64 time, float value)
+{
+    last = value;
+    lastTime = time;
+
+    Push(0, value);
+}
+
+// Every Factor values of a level make one value of the next
+void TimeSeries::Push(int level, float value)
+{
+    Ring &r = levels[level];
+
+    r.Values[(r.Head + r.Count) % Size] = value;
+    if (r.Count == Size)
+        r.Head = (r.Head + 1) % Size;
+    else
+        r.Count++;
+
+    if (level + 1 >= Levels)
+        return;
+
+    r.Sum += value;
+    if (++r.Pending < Factor)
+        return;
+
+    float average = float(r.Sum / r.Pending);
+    r.Sum = 0;
+    r.Pending = 0;
+
+    Push(level + 1, average);
+}
+
+bool TimeSeries::IsEmpty() const
+{
+    return levels[0].Count == 0;
+}
+
+float TimeSeries::Last() const
+{
+    return last;
+}
+
+qint64 TimeSeries::LastTime() const
+{
+    return lastTime;
+}
+
+int TimeSeries::Count(int level) const
+{
+    return levels[level].Count;
+}
+
+// The newest values, oldest first. A level that is full has dropped
+// its oldest values, so more points than it holds come from a coarser
+// level.
+QVector<float> TimeSeries::Recent(int points) const
+{
+    int level = 0;
+    while (level + 1 < Levels && levels[level].Count == Size && points > Size && levels[level + 1].Count >= 2)
+        level++;
+
+    const Ring &r = levels[level];
+    int n = qMin(points, r.Count);
+
+    QVector<float> result(n);
+    for (int i = 0 ; i < n ; i++)
+        result[i] = r.Values[(r.Head + r.Count - n + i) % Size];
+
+    return result;
+}
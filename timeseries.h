@@ -0,0 +1,43 @@
+#ifndef TIMESERIES_H
+#define TIMESERIES_H
+
+#include <QtGlobal>
+#include <QVector>
+
+// Values of one metric over time, in a fixed amount of memory. The
+// newest samples are kept as they came. Older ones are averaged in
+// groups of Factor into the next level, and so on, so each level
+// reaches Factor times further back than the one before.
+class TimeSeries
+{
+public:
+    enum { Size = 120, Factor = 8, Levels = 3 };
+
+    TimeSeries();
+
+    void Add(qint64 time, float value);
+
+    bool IsEmpty() const;
+    float Last() const;
+    qint64 LastTime() const;
+    int Count(int level) const;
+    QVector<float> Recent(int points) const;
+
+protected:
+    struct Ring
+    {
+        float Values[Size];
+        int Head;
+        int Count;
+        double Sum;
+        int Pending;
+    };
+
+    void Push(int level, float value);
+
+    Ring levels[Levels];
+    float last;
+    qint64 lastTime;
+};
+
+#endif // TIMESERIES_H
@@ -0,0 +1,121 @@
+#include "watchview.h"
+#include "panetheme.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+#include <QFontMetrics>
+
+// Longer output scrolls out of the bottom of the view
+static const int MaxVisibleLines = 20;
+
+WatchView::WatchView(QWidget *parent) :
+    QWidget(parent)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setSizePolicy(QSizePolicy::Preferred, QSizePolicy::Fixed);
+
+    QFont f = PaneTheme::Current().Font;
+    f.setPointSize(10);
+    setFont(f);
+}
+
+int WatchView::LineHeight() const
+{
+    return fontMetrics().lineSpacing();
+}
+
+// Line 0 is below the title
+QRect WatchView::LineRect(int line) const
+{
+    return QRect(0, (line + 1) * LineHeight() + 4, width(), LineHeight());
+}
+
+QSize WatchView::sizeHint() const
+{
+    int lines = qMin(shown.size(), MaxVisibleLines);
+
+    return QSize(200, (lines + 1) * LineHeight() + 8);
+}
+
+void WatchView::SetTitle(QString text)
+{
+    title = text;
+
+    update(QRect(0, 0, width(), LineHeight() + 4));
+}
+
+void WatchView::SetLines(QStringList lines)
+{
+    bool resized = qMin(lines.size(), MaxVisibleLines) != qMin(shown.size(), MaxVisibleLines);
+    int count = qMax(lines.size(), shown.size());
+
+    QVector<bool> now(lines.size(), false);
+
+    for (int i = 0 ; i < count ; i++)
+    {
+        bool differs = i >= lines.size() || i >= shown.size() || lines.at(i) != shown.at(i);
+        if (i < lines.size())
+            now[i] = differs;
+
+        // Lines that stopped being different lose their highlight
+        bool was = i < changed.size() && changed.at(i);
+        if (differs || was)
+            update(LineRect(i));
+    }
+
+    shown = lines;
+    changed = now;
+
+    if (resized)
+        updateGeometry();
+}
+
+void WatchView::Clear()
+{
+    shown.clear();
+    changed.clear();
+    updateGeometry();
+    update();
+}
+
+void WatchView::paintEvent(QPaintEvent *event)
+{
+    QPainter p(this);
+
+    const QPalette &palette = PaneTheme::Current().Palette;
+    QRect dirty = event->rect();
+    int lineHeight = LineHeight();
+    int ascent = fontMetrics().ascent();
+
+    QRect header(0, 0, width(), lineHeight + 4);
+    if (dirty.intersects(header))
+    {
+        p.fillRect(header, palette.color(QPalette::Window));
+        p.setPen(palette.color(QPalette::WindowText));
+        p.drawText(header.adjusted(4, 0, -4, 0), Qt::AlignVCenter | Qt::AlignLeft, title);
+    }
+
+    QFont bold = font();
+    bold.setBold(true);
+
+    for (int i = 0 ; i < MaxVisibleLines ; i++)
+    {
+        QRect r = LineRect(i);
+        if (!dirty.intersects(r))
+            continue;
+
+        p.fillRect(r, palette.color(QPalette::Base));
+        if (i >= shown.size())
+            continue;
+
+        bool highlight = i < changed.size() && changed.at(i);
+
+        p.setFont(highlight ? bold : font());
+        p.setPen(highlight ? QColor(0x00, 0x00, 0xff) : palette.color(QPalette::Text));
+        p.drawText(4, r.top() + ascent, shown.at(i));
+    }
+
+    // The gap below the last line
+    QRect rest(0, LineRect(0).top() + qMin(shown.size(), MaxVisibleLines) * lineHeight, width(), height());
+    p.fillRect(rest.intersected(dirty), palette.color(QPalette::Base));
+}
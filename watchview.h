@@ -0,0 +1,34 @@
+#ifndef WATCHVIEW_H
+#define WATCHVIEW_H
+
+#include <QWidget>
+#include <QStringList>
+#include <QVector>
+
+// The output of a watched command, shown above the console input. Each
+// run replaces the one before it in place. Only lines that differ from
+// the last run are repainted, and they stand out until the next one.
+class WatchView : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit WatchView(QWidget *parent = 0);
+
+    void SetTitle(QString title);
+    void SetLines(QStringList lines);
+    void Clear();
+
+    QSize sizeHint() const;
+
+protected:
+    void paintEvent(QPaintEvent *event);
+    QRect LineRect(int line) const;
+    int LineHeight() const;
+
+    QString title;
+    QStringList shown;
+    QVector<bool> changed;
+};
+
+#endif // WATCHVIEW_H